@@ -0,0 +1,325 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+// Generates synthetic workloads in the instruction language and times the simulator on them
+
+#define MAX_PATH_LENGTH 256
+
+// Kinds of generated programs
+typedef enum {
+    WORKLOAD_CPU,       // printFromTo loops
+    WORKLOAD_SEMAPHORE, // Contention over file, userInput and userOutput
+    WORKLOAD_IO,        // writeFile/readFile mixes
+    WORKLOAD_COUNT
+} WorkloadKind;
+
+const char *workload_names[WORKLOAD_COUNT] = {"cpu", "semaphore", "io"};
+
+// Arrival distributions of the generated processes
+typedef enum {
+    ARRIVAL_BURST,   // Everything arrives at cycle 0
+    ARRIVAL_UNIFORM, // One process every gap cycles
+    ARRIVAL_POISSON  // Exponentially distributed gaps with the given mean
+} ArrivalKind;
+
+// Structure to represent the benchmark configuration
+typedef struct {
+    int processes;
+    int length; // Instructions per program
+    ArrivalKind arrivals;
+    double gap; // Mean cycles between arrivals
+    unsigned int seed;
+    int repeat; // Runs per workload, the fastest is reported
+    const char *simulator;
+    const char *directory; // Where programs are generated
+    bool keep; // Keep the generated programs
+    int extraCount; // Arguments passed through to the simulator
+    char **extra;
+} BenchmarkConfig;
+
+// Structure to represent the result of a simulator run
+typedef struct {
+    int cycles;
+    double seconds;
+    long peakKilobytes;
+} RunResult;
+
+// Function to write one generated program, numbered within its workload
+void writeProgram(BenchmarkConfig *config, WorkloadKind kind, int number, const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        perror("Error creating program file");
+        exit(EXIT_FAILURE);
+    }
+    const char *semaphores[] = {"file", "userInput", "userOutput"};
+    int written = 0;
+    switch (kind) {
+    case WORKLOAD_CPU:
+        fprintf(file, "assign a 1\nassign b %d\n", 10 + number % 40);
+        written = 2;
+        while (written < config->length) {
+            fprintf(file, "printFromTo a b\n");
+            written++;
+        }
+        break;
+    case WORKLOAD_SEMAPHORE:
+        fprintf(file, "assign a %d\n", number);
+        written = 1;
+        for (int i = number; written + 3 <= config->length; i++) {
+            const char *semaphore = semaphores[i % 3];
+            fprintf(file, "semWait %s\nprint a\nsemSignal %s\n", semaphore, semaphore);
+            written += 3;
+        }
+        break;
+    case WORKLOAD_IO:
+        fprintf(file, "assign f %s/data_%d.txt\nassign d %d\n", config->directory, number % 8, number);
+        written = 2;
+        for (int i = 0; written + 3 <= config->length; i++) {
+            fprintf(file, "semWait file\n%s\nsemSignal file\n", i % 2 == 0 ? "writeFile f d" : "readFile f");
+            written += 3;
+        }
+        break;
+    default:
+        break;
+    }
+    fclose(file);
+}
+
+// Function to get the arrival times of the generated processes
+void generateArrivals(BenchmarkConfig *config, int *arrivals) {
+    double time = 0;
+    for (int i = 0; i < config->processes; i++) {
+        arrivals[i] = (int)time;
+        if (config->arrivals == ARRIVAL_UNIFORM) {
+            time += config->gap;
+        } else if (config->arrivals == ARRIVAL_POISSON) {
+            double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+            time += -config->gap * log(u);
+        }
+    }
+}
+
+// Function to read the simulated cycles from a metrics report, -1 if it cannot be read
+int readCycles(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return -1;
+    }
+    char line[512];
+    int cycles = -1;
+    while (fgets(line, sizeof(line), file)) {
+        if (strncmp(line, "cycles,", 7) == 0) {
+            cycles = atoi(line + 7);
+        }
+    }
+    fclose(file);
+    return cycles;
+}
+
+// Function to run the simulator once on a workload, measuring host time and peak memory
+bool runSimulator(BenchmarkConfig *config, char **programs, int *arrivals, const char *metricsPath, RunResult *result) {
+    int argc = 0;
+    char **argv = (char **)calloc(6 + config->extraCount + 2 * config->processes, sizeof(char *));
+    char (*times)[16] = calloc(config->processes, sizeof(*times));
+    if (argv == NULL || times == NULL) {
+        perror("Error allocating simulator arguments");
+        exit(EXIT_FAILURE);
+    }
+    argv[argc++] = (char *)config->simulator;
+    argv[argc++] = "--output";
+    argv[argc++] = "silent";
+    argv[argc++] = "--metrics";
+    argv[argc++] = (char *)metricsPath;
+    for (int i = 0; i < config->extraCount; i++) {
+        argv[argc++] = config->extra[i];
+    }
+    for (int i = 0; i < config->processes; i++) {
+        snprintf(times[i], sizeof(times[i]), "%d", arrivals[i]);
+        argv[argc++] = times[i];
+        argv[argc++] = programs[i];
+    }
+    argv[argc] = NULL;
+
+    struct timespec start, end;
+    fflush(stdout); // The child must not inherit unwritten output
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid_t child = fork();
+    if (child == 0) {
+        freopen("/dev/null", "r", stdin);
+        freopen("/dev/null", "w", stdout);
+        execv(config->simulator, argv);
+        perror("Error starting simulator");
+        _exit(127);
+    }
+    int status;
+    struct rusage usage;
+    bool ok = child > 0 && wait4(child, &status, 0, &usage) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    free(argv);
+    free(times);
+    if (!ok) {
+        return false;
+    }
+    result->seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    result->peakKilobytes = usage.ru_maxrss;
+    result->cycles = readCycles(metricsPath);
+    return result->cycles >= 0;
+}
+
+// Function to generate and time one workload, returns false if the simulator failed
+bool benchmarkWorkload(BenchmarkConfig *config, WorkloadKind kind) {
+    char **programs = (char **)calloc(config->processes, sizeof(char *));
+    int *arrivals = (int *)calloc(config->processes, sizeof(int));
+    if (programs == NULL || arrivals == NULL) {
+        perror("Error allocating workload");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < config->processes; i++) {
+        programs[i] = (char *)malloc(MAX_PATH_LENGTH);
+        snprintf(programs[i], MAX_PATH_LENGTH, "%s/%s_%d.txt", config->directory, workload_names[kind], i);
+        writeProgram(config, kind, i, programs[i]);
+    }
+    generateArrivals(config, arrivals);
+
+    char metricsPath[MAX_PATH_LENGTH];
+    snprintf(metricsPath, sizeof(metricsPath), "%s/%s_metrics.csv", config->directory, workload_names[kind]);
+    RunResult best = {0, 0, 0};
+    bool ok = true;
+    for (int run = 0; run < config->repeat && ok; run++) {
+        RunResult result;
+        ok = runSimulator(config, programs, arrivals, metricsPath, &result);
+        if (ok && (run == 0 || result.seconds < best.seconds)) {
+            best = result;
+        }
+    }
+    if (ok) {
+        printf("| %-10s | %-9d | %-10d | %10.4f | %14.0f | %12ld |\n", workload_names[kind], config->processes,
+               best.cycles, best.seconds, best.seconds > 0 ? best.cycles / best.seconds : 0, best.peakKilobytes);
+    } else {
+        printf("| %-10s | Simulator failed, use --keep <directory> to rerun it on the programs\n", workload_names[kind]);
+    }
+
+    if (!config->keep) {
+        for (int i = 0; i < config->processes; i++) {
+            remove(programs[i]);
+        }
+        remove(metricsPath);
+    }
+    for (int i = 0; i < config->processes; i++) {
+        free(programs[i]);
+    }
+    free(programs);
+    free(arrivals);
+    return ok;
+}
+
+void printUsage(const char *name) {
+    printf("Usage: %s [--simulator <path>] [--workload cpu|semaphore|io|all] [--processes <count>] [--length <instructions>]\n", name);
+    printf("          [--arrivals burst|uniform|poisson] [--gap <cycles>] [--seed <seed>] [--repeat <runs>] [--keep <directory>]\n");
+    printf("          [-- <simulator options>]\n");
+}
+
+int main(int argc, char *argv[]) {
+    BenchmarkConfig config = {20, 12, ARRIVAL_UNIFORM, 2, 1, 3, "./os", NULL, false, 0, NULL};
+    int workload = -1; // All workloads
+
+    for (int i = 1; i < argc; i += 2) {
+        if (strcmp(argv[i], "--") == 0) {
+            config.extra = argv + i + 1;
+            config.extraCount = argc - i - 1;
+            break;
+        }
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (strcmp(argv[i], "--simulator") == 0) {
+            config.simulator = argv[i + 1];
+        } else if (strcmp(argv[i], "--workload") == 0) {
+            workload = -1;
+            for (int kind = 0; kind < WORKLOAD_COUNT; kind++) {
+                if (strcmp(argv[i + 1], workload_names[kind]) == 0) {
+                    workload = kind;
+                }
+            }
+            if (workload == -1 && strcmp(argv[i + 1], "all") != 0) {
+                printf("Error: Unknown workload %s\n", argv[i + 1]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--processes") == 0) {
+            config.processes = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "--length") == 0) {
+            config.length = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "--arrivals") == 0) {
+            if (strcmp(argv[i + 1], "burst") == 0) {
+                config.arrivals = ARRIVAL_BURST;
+            } else if (strcmp(argv[i + 1], "uniform") == 0) {
+                config.arrivals = ARRIVAL_UNIFORM;
+            } else if (strcmp(argv[i + 1], "poisson") == 0) {
+                config.arrivals = ARRIVAL_POISSON;
+            } else {
+                printf("Error: Unknown arrival distribution %s\n", argv[i + 1]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--gap") == 0) {
+            config.gap = atof(argv[i + 1]);
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            config.seed = (unsigned int)strtoul(argv[i + 1], NULL, 10);
+        } else if (strcmp(argv[i], "--repeat") == 0) {
+            config.repeat = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "--keep") == 0) {
+            config.directory = argv[i + 1];
+            config.keep = true;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (config.processes < 1 || config.length < 4 || config.repeat < 1 || config.gap < 0) {
+        printf("Error: Need at least 1 process, 4 instructions per program, 1 run and a non-negative gap\n");
+        return 1;
+    }
+
+    char directory[MAX_PATH_LENGTH];
+    if (config.directory == NULL) {
+        snprintf(directory, sizeof(directory), "/tmp/os_benchmark_XXXXXX");
+        if (mkdtemp(directory) == NULL) {
+            perror("Error creating workload directory");
+            return 1;
+        }
+        config.directory = directory;
+    } else if (mkdir(config.directory, 0755) != 0 && access(config.directory, W_OK) != 0) {
+        perror("Error creating workload directory");
+        return 1;
+    }
+
+    printf("+------------+-----------+------------+------------+----------------+--------------+\n");
+    printf("| Workload   | Processes | Cycles     | Host (s)   | Cycles/second  | Peak RSS (KB)|\n");
+    printf("+------------+-----------+------------+------------+----------------+--------------+\n");
+    bool ok = true;
+    for (int kind = 0; kind < WORKLOAD_COUNT; kind++) {
+        if (workload == -1 || workload == kind) {
+            srand(config.seed); // Every workload gets the same arrivals
+            ok = benchmarkWorkload(&config, (WorkloadKind)kind) && ok;
+        }
+    }
+    printf("+------------+-----------+------------+------------+----------------+--------------+\n");
+
+    if (!config.keep) {
+        for (int i = 0; i < 8; i++) {
+            char path[MAX_PATH_LENGTH];
+            snprintf(path, sizeof(path), "%s/data_%d.txt", config.directory, i);
+            remove(path);
+        }
+        rmdir(config.directory);
+    }
+    return ok ? 0 : 1;
+}
@@ -3,20 +3,174 @@
 #include <string.h>
 #include <unistd.h>
 #include <stdbool.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 
-#define MEMORY_SIZE 60
-#define MAX_VARIABLES_PER_PROCESS 3
+#ifndef MEMORY_SIZE
+#define MEMORY_SIZE 60 // Words of memory, can be overridden with -DMEMORY_SIZE=<words>
+#endif
+#ifndef MAX_VARIABLES_PER_PROCESS
+#define MAX_VARIABLES_PER_PROCESS 8 // Variables a program can use, can be overridden with -DMAX_VARIABLES_PER_PROCESS=<count>
+#endif
+#define VARIABLE_BUCKETS (2 * MAX_VARIABLES_PER_PROCESS) // Hash buckets of a program's variable names
 #define MAX_LINE_LENGTH 100
-#define MAX_PROCESSES 10
-#define TIME_QUANTUM 1
+#define TIME_QUANTUM 1 // Default quantum of round-robin
+#define MLFQ_LEVELS 4
+#define AGING_THRESHOLD 20 // Cycles a process waits in a lower MLFQ level before it is promoted
 
-// Global variables for mutexes
-int file_mutex = 1;
-int user_input_mutex = 1;
-int screen_output_mutex = 1;
+// Opcodes of decoded instructions
+typedef enum {
+    OP_PRINT,
+    OP_ASSIGN,          // assign x <literal>
+    OP_ASSIGN_INPUT,    // assign x input
+    OP_ASSIGN_READFILE, // assign x readFile y
+    OP_WRITE_FILE,
+    OP_READ_FILE,
+    OP_PRINT_FROM_TO,
+    OP_SEM_WAIT,
+    OP_SEM_SIGNAL,
+    OPCODE_COUNT
+} Opcode;
+
+// Structure to represent a decoded instruction
+typedef struct {
+    Opcode opcode;
+    int operand1; // Variable index, or index of the program's semaphore for semWait/semSignal
+    int operand2; // Variable index, or offset of the literal in the source line for assign
+} Instruction;
+
+// Host-side profiling of the simulator, compiled in with -DPROFILE and free otherwise
+#ifdef PROFILE
+typedef enum {
+    PROFILE_PHASE_EVENTS, // Main loop phases
+    PROFILE_PHASE_DISPATCH,
+    PROFILE_PHASE_OUTPUT,
+    PROFILE_PHASE_EXECUTE,
+    PROFILE_PHASE_RETIRE,
+    PROFILE_DECODE,
+    PROFILE_QUEUE,
+    PROFILE_STORAGE,
+    PROFILE_MEMORY,
+    PROFILE_SWAP,
+    PROFILE_FLUSH,
+    PROFILE_INSTRUCTION, // One counter per opcode from here on
+    PROFILE_COUNTERS = PROFILE_INSTRUCTION + OPCODE_COUNT
+} ProfileCounter;
+
+const char *profile_names[PROFILE_COUNTERS] = {
+    "phase: events", "phase: dispatch", "phase: output", "phase: execute", "phase: retire",
+    "decode", "queue", "storage unit", "memory", "swap", "output flush",
+    "print", "assign", "assign input", "assign readFile", "writeFile", "readFile", "printFromTo", "semWait", "semSignal"
+};
+
+uint64_t profileCalls[PROFILE_COUNTERS];
+uint64_t profileNanoseconds[PROFILE_COUNTERS];
+
+// Function to read the host's monotonic clock in nanoseconds
+uint64_t profileNow() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + now.tv_nsec;
+}
+
+// Function to add a timed call to a counter, counters are shared by the worker threads
+void profileAdd(int counter, uint64_t start) {
+    __atomic_fetch_add(&profileCalls[counter], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&profileNanoseconds[counter], profileNow() - start, __ATOMIC_RELAXED);
+}
+
+// Function to print the profile to stderr, so it stays out of the simulation output
+void printProfile() {
+    fprintf(stderr, "Profile:\n");
+    fprintf(stderr, "+-----------------+------------+--------------+------------+\n");
+    fprintf(stderr, "| Counter         | Calls      | Total (ms)   | ns/call    |\n");
+    fprintf(stderr, "+-----------------+------------+--------------+------------+\n");
+    for (int i = 0; i < PROFILE_COUNTERS; i++) {
+        if (profileCalls[i] == 0) {
+            continue;
+        }
+        fprintf(stderr, "| %-15s | %-10llu | %12.3f | %10.1f |\n", profile_names[i], (unsigned long long)profileCalls[i],
+                profileNanoseconds[i] / 1e6, (double)profileNanoseconds[i] / profileCalls[i]);
+    }
+    fprintf(stderr, "+-----------------+------------+--------------+------------+\n");
+}
+
+#define PROFILE_START(timer) uint64_t timer = profileNow()
+#define PROFILE_STOP(timer, counter) profileAdd(counter, timer)
+#else
+#define PROFILE_START(timer)
+#define PROFILE_STOP(timer, counter)
+#endif
+
+// Fields of the PCB as laid out at the start of a process's memory
+typedef enum {
+    PCB_PROCESS_ID,
+    PCB_PROCESS_STATE,
+    PCB_PROGRAM_COUNTER,
+    PCB_MEMORY_LOWER_BOUND,
+    PCB_MEMORY_UPPER_BOUND,
+    PCB_CYCLES_REMAINING,
+    PCB_WAITING_FOR_RESOURCE,
+    PCB_WORDS
+} PcbField;
+
+const char *pcb_field_names[PCB_WORDS] = {"id", "state", "pc", "lower", "upper", "quantum", "waiting"};
+
+// Layout of a process's data segment: PCB, then one word per variable of its program. Instructions live in the code segment of its program
+#define VARIABLES_OFFSET PCB_WORDS
+#define MAX_INSTRUCTIONS (MEMORY_SIZE - PCB_WORDS)
+
+// Types of memory words
+typedef enum {
+    WORD_FREE,
+    WORD_PCB,
+    WORD_VARIABLE,
+    WORD_INSTRUCTION
+} WordType;
+
+// Types of variable values
+typedef enum {
+    VALUE_UNSET,
+    VALUE_INTEGER,
+    VALUE_STRING
+} ValueType;
+
+// Structure to represent one word of memory
+typedef struct {
+    WordType type;
+    int owner; // ID of the process the word belongs to
+    union {
+        int field; // PCB field
+        struct {
+            ValueType type;
+            int number; // Parsed when the value is stored, valid if the type is VALUE_INTEGER
+            char text[MAX_LINE_LENGTH];
+        } variable;
+        struct {
+            Instruction decoded;
+            char text[MAX_LINE_LENGTH]; // Source text, kept for display
+        } instruction;
+    };
+} MemoryWord;
+
+// Structure to represent a free region of memory
+typedef struct {
+    int start;
+    int size;
+} MemoryHole;
 
 // Total memory storage
-char memory[MEMORY_SIZE][MAX_LINE_LENGTH];
+MemoryWord memory[MEMORY_SIZE];
+MemoryHole memoryHoles[MEMORY_SIZE]; // Free regions sorted by address
+int memoryHoleCount = 0;
 
 // Structure to represent a Process Control Block (PCB)
 typedef struct {
@@ -25,16 +179,74 @@ typedef struct {
     int program_counter;
     int memory_lower_bound;
     int memory_upper_bound;
-    int cycles_remaining; // Cycles remaining in the current time quantum
-    char waiting_for_resource[MAX_LINE_LENGTH]; // Resource the process is waiting for
+    int cycles_remaining; // Cycles remaining in the current time quantum, -1 if unlimited
+    int waiting_for_resource; // Semaphore the process is waiting for, -1 if none
 } PCB;
 
-// Structure to represent a Process
+// Structure to represent a semaphore a program uses, bound to the semaphore table of each run using the program
+typedef struct {
+    char name[MAX_LINE_LENGTH];
+    int initial_value; // Declared by the program, -1 if it is not declared
+    int id; // Semaphore ID in the current run
+} ProgramSemaphore;
+
+// Structure to represent a decoded program file, loaded once and shared by every process and run using it
 typedef struct {
-    char instructions[MEMORY_SIZE][MAX_LINE_LENGTH];
-    char variables[MAX_VARIABLES_PER_PROCESS][MAX_LINE_LENGTH];
+    char *file;
+    int instruction_count;
+    char variable_names[MAX_VARIABLES_PER_PROCESS][MAX_LINE_LENGTH]; // Resolved at load time
+    int variable_count;
+    unsigned short variable_buckets[VARIABLE_BUCKETS]; // Variable index + 1 by name hash, 0 if empty
+    ProgramSemaphore *semaphores; // Semaphores named by the program, in order of first use
+    int semaphore_count;
+    MemoryWord *code; // Decoded instructions, copied into memory when the first process using them is admitted
+    int code_base; // Address of the code segment, -1 if it is not resident
+    int references; // Resident processes sharing the code segment
+} Program;
+
+// Structure to represent the scheduling statistics of a process
+typedef struct {
+    int process_id;
+    int arrival_time;
+    const char *program_file;
+    int first_run; // Clock cycle the process was first dispatched, -1 if it never ran
+    int finish_time; // Clock cycle the process finished, -1 if it did not
+    int waiting_cycles; // Cycles spent in ready queues
+    int cpu_cycles; // Instructions executed
+    int dispatches; // Times the process was put on a core
+    int io_errors; // File operations that failed
+    int blocked_since; // Clock cycle the process last blocked on a semaphore
+    int *blocked_cycles; // Cycles spent blocked on each semaphore, indexed by semaphore ID
+    int io_cycles; // Cycles spent waiting for I/O devices
+} ProcessMetrics;
+
+// Structure to represent a Process
+typedef struct Process {
     PCB pcb;
     int arrival_time;
+    Program *program; // Decoded program, shared by every process running the same file
+    struct Process *storage_prev; // Neighbours in the storage unit, in admission order
+    struct Process *storage_next;
+    struct Process *resident_prev; // Neighbours among the stored processes that are in memory, in admission order
+    struct Process *resident_next;
+    long admission; // Position in the admission order of the storage unit
+    int last_used; // Clock cycle the process was last loaded or executed
+    int ready_since; // Clock cycle the process last entered the ready queue
+    int priority_level; // MLFQ level, 0 is the highest priority
+    int core; // Core the process last ran on or was assigned to
+    int io_device; // Device whose request the process is waiting for, -1 if none
+    int pending_input; // Variable waiting for a line typed on the console, -1 if none
+    int base_priority_level; // MLFQ level before priority inheritance, -1 if the process has not inherited one
+    bool in_deadlock; // Blocked in a deadlock that has been reported
+    int wait_for_check; // Last check of the wait-for graph that visited the process
+    FILE *input_file; // Input of the process with the file input provider, NULL until first read
+    unsigned int input_seed; // State of the random input provider, 0 until first read
+    int input_position; // Next record of the replay log to look at
+    bool swapped; // True while the process's memory is in the swap file
+    long swap_offset; // Offset of the process's slot in the swap file, -1 if it has none
+    int swap_capacity; // Size of the slot in bytes
+    int swap_size; // Size of the record currently stored in the slot
+    ProcessMetrics metrics;
 } Process;
 
 // Define Process State
@@ -45,9 +257,10 @@ typedef enum {
     FINISHED
 } ProcessState;
 
-// Queue for process management
+// Queue for process management, a ring buffer that doubles its capacity when full
 typedef struct {
-    Process *processes[MAX_PROCESSES];
+    Process **processes;
+    int capacity;
     int front;
     int rear;
     int size;
@@ -55,11 +268,19 @@ typedef struct {
 
 // Function to initialize the queue
 void initQueue(ProcessQueue *queue) {
+    queue->processes = NULL;
+    queue->capacity = 0;
     queue->front = 0;
     queue->rear = -1;
     queue->size = 0;
 }
 
+// Function to release the storage of the queue
+void freeQueue(ProcessQueue *queue) {
+    free(queue->processes);
+    initQueue(queue);
+}
+
 // Function to check if the queue is empty
 bool isQueueEmpty(ProcessQueue *queue) {
     return queue->size == 0;
@@ -67,497 +288,4438 @@ bool isQueueEmpty(ProcessQueue *queue) {
 
 // Function to check if the queue is full
 bool isQueueFull(ProcessQueue *queue) {
-    return queue->size == MAX_PROCESSES;
+    return queue->size == queue->capacity;
+}
+
+// Function to double the capacity of the queue, keeping its order
+void growQueue(ProcessQueue *queue) {
+    int capacity = queue->capacity == 0 ? 8 : queue->capacity * 2;
+    Process **processes = (Process **)malloc(capacity * sizeof(Process *));
+    if (processes == NULL) {
+        perror("Error growing queue");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < queue->size; i++) {
+        processes[i] = queue->processes[(queue->front + i) % queue->capacity];
+    }
+    free(queue->processes);
+    queue->processes = processes;
+    queue->capacity = capacity;
+    queue->front = 0;
+    queue->rear = queue->size - 1;
 }
 
 // Function to enqueue a process
 void enqueue(ProcessQueue *queue, Process *process) {
-    if (!isQueueFull(queue)) {
-        queue->rear = (queue->rear + 1) % MAX_PROCESSES;
-        queue->processes[queue->rear] = process;
-        queue->size++;
+    PROFILE_START(timer);
+    if (isQueueFull(queue)) {
+        growQueue(queue);
+    }
+    queue->rear = (queue->rear + 1) % queue->capacity;
+    queue->processes[queue->rear] = process;
+    queue->size++;
+    PROFILE_STOP(timer, PROFILE_QUEUE);
+}
+
+// Function to remove the process at a position counted from the front of the queue
+Process* removeFromQueue(ProcessQueue *queue, int position) {
+    PROFILE_START(timer);
+    int index = (queue->front + position) % queue->capacity;
+    Process *process = queue->processes[index];
+    // Shift the processes behind it one place forward
+    for (int i = position; i < queue->size - 1; i++) {
+        int next = (index + 1) % queue->capacity;
+        queue->processes[index] = queue->processes[next];
+        index = next;
     }
+    queue->rear = (queue->rear - 1 + queue->capacity) % queue->capacity;
+    queue->size--;
+    PROFILE_STOP(timer, PROFILE_QUEUE);
+    return process;
+}
+
+// Function to find the position of a process counted from the front of the queue, -1 if it is not queued
+int queuePosition(ProcessQueue *queue, Process *process) {
+    for (int i = 0; i < queue->size; i++) {
+        if (queue->processes[(queue->front + i) % queue->capacity] == process) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Function to remove the process at the rear of the queue
+Process* dequeueRear(ProcessQueue *queue) {
+    if (isQueueEmpty(queue)) {
+        return NULL;
+    }
+    PROFILE_START(timer);
+    Process *process = queue->processes[queue->rear];
+    queue->rear = (queue->rear - 1 + queue->capacity) % queue->capacity;
+    queue->size--;
+    PROFILE_STOP(timer, PROFILE_QUEUE);
+    return process;
 }
 
 // Function to dequeue a process
 Process* dequeue(ProcessQueue *queue) {
     if (!isQueueEmpty(queue)) {
+        PROFILE_START(timer);
         Process *process = queue->processes[queue->front];
-        queue->front = (queue->front + 1) % MAX_PROCESSES;
+        queue->front = (queue->front + 1) % queue->capacity;
         queue->size--;
+        PROFILE_STOP(timer, PROFILE_QUEUE);
         return process;
     }
     return NULL;
 }
 
-// Global operating system state
-ProcessQueue readyQueue; // Ready queue for processes
-ProcessQueue blockedQueue; // Blocked queue for processes
-ProcessQueue storageQueue; // Storage unit for processes
-int clockCycles = 0; // Global clock cycle counter
-int next_process_id = 1;
+// Storage unit for admitted processes, indexed by process ID and linked in admission order
+typedef struct {
+    Process **slots; // Indexed by process ID, NULL if the process is not stored
+    int capacity;
+    Process *head;
+    Process *tail;
+    int size;
+    Process *resident_head; // Stored processes that are not swapped out, the candidates for swapping
+    Process *resident_tail;
+    long admissions;
+} StorageUnit;
 
-// Function to allocate memory for a process
-void allocateMemory(Process *process, int memory_lower_bound, int memory_upper_bound) {
-    process->pcb.memory_lower_bound = memory_lower_bound;
-    process->pcb.memory_upper_bound = memory_upper_bound;
+// Function to initialize the storage unit
+void initStorageUnit(StorageUnit *unit) {
+    unit->slots = NULL;
+    unit->capacity = 0;
+    unit->head = NULL;
+    unit->tail = NULL;
+    unit->size = 0;
+    unit->resident_head = NULL;
+    unit->resident_tail = NULL;
+    unit->admissions = 0;
 }
 
-// Function to store instructions in memory for a process
-void storeInstructions(Process *process, char *instruction, int instruction_index) {
-    strcpy(process->instructions[instruction_index], instruction);
+// Function to add a stored process that is in memory to the resident list, keeping admission order
+void addResident(StorageUnit *unit, Process *process) {
+    // Newly admitted processes go last, processes swapped back in are found walking back from the end
+    Process *prev = unit->resident_tail;
+    while (prev != NULL && prev->admission > process->admission) {
+        prev = prev->resident_prev;
+    }
+    Process *next = prev != NULL ? prev->resident_next : unit->resident_head;
+    process->resident_prev = prev;
+    process->resident_next = next;
+    if (prev != NULL) {
+        prev->resident_next = process;
+    } else {
+        unit->resident_head = process;
+    }
+    if (next != NULL) {
+        next->resident_prev = process;
+    } else {
+        unit->resident_tail = process;
+    }
 }
 
-// Function to store variables in memory for a process
-void storeVariables(Process *process, char *variable, char *value) {
-    for (int i = 0; i < MAX_VARIABLES_PER_PROCESS; i++) {
-        if (process->variables[i][0] == '\0' || strncmp(process->variables[i], variable, strlen(variable)) == 0) {
-            snprintf(process->variables[i], sizeof(process->variables[i]), "%s=%s", variable, value);
-            break;
-        }
+// Function to remove a process from the resident list when it leaves memory
+void removeResident(StorageUnit *unit, Process *process) {
+    if (process->resident_prev != NULL) {
+        process->resident_prev->resident_next = process->resident_next;
+    } else {
+        unit->resident_head = process->resident_next;
     }
+    if (process->resident_next != NULL) {
+        process->resident_next->resident_prev = process->resident_prev;
+    } else {
+        unit->resident_tail = process->resident_prev;
+    }
+    process->resident_prev = NULL;
+    process->resident_next = NULL;
 }
 
-char* retrieveVariable(Process *process, const char *variable_name) {
-    for (int i = 0; i < MAX_VARIABLES_PER_PROCESS; i++) {
-        char *var_value_pair = process->variables[i];
-        if (var_value_pair != NULL && var_value_pair[0] != '\0') {
-            char *var = strtok(var_value_pair, "=");
-            if (strcmp(var, variable_name) == 0) {
-                char *val = strtok(NULL, "=");
-                return val;
-            }
+// Function to release the storage of the storage unit
+void freeStorageUnit(StorageUnit *unit) {
+    free(unit->slots);
+    initStorageUnit(unit);
+}
+
+// Function to add a process to the storage unit
+void storeProcess(StorageUnit *unit, Process *process) {
+    PROFILE_START(timer);
+    int id = process->pcb.process_id;
+    if (id >= unit->capacity) {
+        int capacity = unit->capacity == 0 ? 8 : unit->capacity;
+        while (capacity <= id) {
+            capacity *= 2;
+        }
+        Process **slots = (Process **)realloc(unit->slots, capacity * sizeof(Process *));
+        if (slots == NULL) {
+            perror("Error growing storage unit");
+            exit(EXIT_FAILURE);
         }
+        memset(slots + unit->capacity, 0, (capacity - unit->capacity) * sizeof(Process *));
+        unit->slots = slots;
+        unit->capacity = capacity;
     }
-    return NULL;
+    unit->slots[id] = process;
+    process->storage_prev = unit->tail;
+    process->storage_next = NULL;
+    if (unit->tail != NULL) {
+        unit->tail->storage_next = process;
+    } else {
+        unit->head = process;
+    }
+    unit->tail = process;
+    unit->size++;
+    process->admission = unit->admissions++;
+    if (!process->swapped) {
+        addResident(unit, process);
+    }
+    PROFILE_STOP(timer, PROFILE_STORAGE);
 }
 
-void executeAssign(Process *process, char *variable, char *value) {
-    if (strcmp(value, "input") == 0) {
-        printf("Please enter a value for variable %s: ", variable);
-        fgets(value, MAX_LINE_LENGTH, stdin); // Read input as a string
-        value[strcspn(value, "\n")] = '\0'; // Remove newline character
-    } else if (strncmp(value, "readFile", 8) == 0) {
-        // Handle readFile instruction
-        char *fileVar = value + 9; // Skip "readFile " to get the variable name
-        char *filename = retrieveVariable(process, fileVar);
-        if (filename != NULL) {
-            FILE *file = fopen(filename, "r");
-            if (file == NULL) {
-                perror("Error opening file");
-                printf("Error opening file: %s\n", filename);
-                exit(EXIT_FAILURE);
-            }
-            char fileData[MAX_LINE_LENGTH];
-            if (fgets(fileData, sizeof(fileData), file) != NULL) {
-                fileData[strcspn(fileData, "\n")] = '\0';
-                strcpy(value, fileData);
-            }
-            fclose(file);
-        } else {
-            printf("Filename variable '%s' not found.\n", fileVar);
-            return;
-        }
+// Function to find a stored process by its ID, NULL if it is not stored
+Process* findStoredProcess(StorageUnit *unit, int process_id) {
+    if (process_id < 0 || process_id >= unit->capacity) {
+        return NULL;
     }
-    storeVariables(process, variable, value);
+    return unit->slots[process_id];
 }
 
-void executeWriteFile(Process *process, const char *filename_variable, const char *data_variable) {
-    char *filename = retrieveVariable(process, filename_variable);
-    char *data = retrieveVariable(process, data_variable);
-    if (filename != NULL && data != NULL) {
-        printf("Creating file: %s\n", filename); // Print the filename
-        FILE *file = fopen(filename, "w"); // "w" mode creates the file if it doesn't exist
-        if (file == NULL) {
-            perror("Error opening file");
-            printf("Error opening file: %s\n", filename);
-            exit(EXIT_FAILURE);
-        }
-        if (fprintf(file, "%s", data) < 0) {
-            perror("Error writing to file");
-            fclose(file);
-            exit(EXIT_FAILURE);
-        }
-        if (fclose(file) != 0) {
-            perror("Error closing file");
-            exit(EXIT_FAILURE);
-        }
+// Function to remove a process from the storage unit
+void removeStoredProcess(StorageUnit *unit, Process *process) {
+    PROFILE_START(timer);
+    if (process->storage_prev != NULL) {
+        process->storage_prev->storage_next = process->storage_next;
+    } else {
+        unit->head = process->storage_next;
+    }
+    if (process->storage_next != NULL) {
+        process->storage_next->storage_prev = process->storage_prev;
     } else {
-        printf("Error: Invalid filename or data.\n");
+        unit->tail = process->storage_prev;
     }
+    unit->slots[process->pcb.process_id] = NULL;
+    process->storage_prev = NULL;
+    process->storage_next = NULL;
+    unit->size--;
+    if (!process->swapped) {
+        removeResident(unit, process);
+    }
+    PROFILE_STOP(timer, PROFILE_STORAGE);
 }
 
-void executeReadFile(Process *process, const char *filename_variable) {
-    char *filename = retrieveVariable(process, filename_variable);
-    if (filename != NULL) {
-        FILE *file = fopen(filename, "r");
-        if (file == NULL) {
-            perror("Error opening file");
-            printf("Error opening file: %s\n", filename);
-            exit(EXIT_FAILURE);
-        }
-        char data[MAX_LINE_LENGTH];
-        while (fgets(data, sizeof(data), file)) {
-            printf("%s", data);
+// Ready processes, FCFS, round-robin, SJF and HRRN only use the first level
+typedef struct {
+    ProcessQueue levels[MLFQ_LEVELS];
+} RunQueue;
+
+// Structure to represent a scheduling policy
+typedef struct {
+    const char *name;
+    void (*add)(RunQueue *queue, Process *process); // Add a process that became ready
+    Process* (*pick)(RunQueue *queue); // Remove and return the process to run next
+    int (*quantum)(Process *process); // Quantum for the picked process, -1 to run until it blocks or finishes
+    void (*expired)(Process *process); // Called when a process used up its quantum
+} Scheduler;
+
+// Structure to represent a simulated CPU core
+typedef struct {
+    int id;
+    RunQueue readyQueue; // Ready queue of the core
+    Process *runningProcess; // Keeps the core until it blocks, finishes or its quantum expires
+    long busyCycles; // Cycles the core spent executing instructions
+    int migrations; // Processes the core stole from other cores
+    pthread_mutex_t readyLock; // Guards the ready queue while cores run on several threads
+    bool deferred; // Instruction left for the ordered commit phase in deterministic mode
+    char *output; // Output of the current cycle, printed in core order once every core has executed
+    size_t outputLength;
+    size_t outputCapacity;
+} Core;
+
+// Structure to represent a named counting semaphore
+typedef struct {
+    char name[MAX_LINE_LENGTH];
+    int value;
+    bool declared; // Initial value was set by a program's declaration
+    ProcessQueue waiters[MLFQ_LEVELS]; // Blocked processes, by MLFQ level with priority wait queues
+    int waiterCount;
+    ProcessQueue holders; // Processes holding units, once per unit, the edges of the wait-for graph
+    pthread_mutex_t lock; // Guards the value and the waiters while cores run on several threads
+} Semaphore;
+
+// Global operating system state
+Program **programs; // Decoded program files, shared by processes and by the runs of a batch
+int programCount = 0;
+Core *cores; // Simulated CPU cores, each with its own ready queue
+int coreCount = 1;
+Semaphore *semaphores; // Semaphores interned by name, indexed by ID
+int semaphoreCount = 0;
+bool priorityWaitQueues = false; // Wake the waiter with the highest MLFQ priority instead of the longest waiting
+
+// Response to a deadlock found in the wait-for graph
+typedef enum {
+    DEADLOCK_REPORT,  // Report it, the processes stay blocked
+    DEADLOCK_ABORT,   // Terminate the victim, releasing the semaphores it holds
+    DEADLOCK_PREEMPT, // Take the victim's semaphores and restart it from its first instruction
+    DEADLOCK_STOP     // End the simulation
+} DeadlockPolicy;
+
+const char *deadlock_policy_names[] = {"report", "abort", "preempt", "stop"};
+DeadlockPolicy deadlockPolicy = DEADLOCK_REPORT;
+bool priorityInheritance = false; // Holders of a semaphore run at the highest MLFQ level of its waiters
+int deadlockCount = 0;
+int priorityInversions = 0;
+bool deadlockStopped = false; // A deadlock ended the simulation
+int waitForChecks = 0; // Checks of the wait-for graph so far, marks the processes each check has visited
+ProcessQueue wakeQueue; // Processes unblocked in the current cycle, made ready once every core has executed
+
+// Simulated I/O devices
+typedef enum {
+    DEVICE_DISK,    // readFile, writeFile and assign x readFile y
+    DEVICE_CONSOLE, // assign x input
+    DEVICE_COUNT
+} DeviceId;
+
+// Structure to represent an I/O device, it services one request at a time in issue order
+typedef struct {
+    const char *name;
+    int latency; // Cycles to service a request, 0 completes requests within the instruction
+    int busy_until; // Clock cycle the device completes its last queued request
+    ProcessQueue pending; // Processes waiting for their requests, in completion order
+    int requests;
+    int busy_cycles;
+} IoDevice;
+
+IoDevice devices[DEVICE_COUNT] = {{.name = "disk"}, {.name = "console"}};
+
+StorageUnit storageUnit; // Storage unit for processes
+ProcessQueue memoryQueue; // Arrived processes waiting for free memory
+int clockCycles = 0; // Global clock cycle counter
+int next_process_id = 1;
+
+// Host threads executing the cores
+int threadCount = 1;
+bool deterministic = false; // Runs instructions touching shared state in core order after the parallel phase
+pthread_mutex_t wakeLock = PTHREAD_MUTEX_INITIALIZER; // Guards wakeQueue
+pthread_mutex_t fileLock = PTHREAD_MUTEX_INITIALIZER; // Serializes access to files
+pthread_mutex_t outputLock = PTHREAD_MUTEX_INITIALIZER; // Serializes console input and output flushes
+
+// Output levels, from the full tables before every cycle down to errors only
+typedef enum {
+    OUTPUT_TABLES,  // Queue and memory tables before every cycle along with the program output
+    OUTPUT_EVENTS,  // Newline-delimited JSON event log, rendered as tables offline by TraceViewer
+    OUTPUT_SUMMARY, // Statistics at exit only
+    OUTPUT_SILENT   // Errors only
+} OutputLevel;
+
+#define TRACE_BUFFER_SIZE (1 << 20)
+
+OutputLevel outputLevel = OUTPUT_TABLES;
+FILE *outputFile; // Tables, scheduler messages, program output, the event log and the summary, stdout unless --trace-file is given
+
+// Statistics of finished processes, and of unfinished ones once the simulation has ended
+ProcessMetrics *metricsRecords;
+int metricsCount = 0;
+int metricsCapacity = 0;
+const char *metricsPath; // Where the statistics report is written at exit, NULL if it is not wanted
+
+// Scheduler configuration
+int timeQuantum = TIME_QUANTUM;
+int mlfqQuanta[MLFQ_LEVELS] = {1, 2, 4, 8};
+int agingThreshold = AGING_THRESHOLD;
+
+// Function to initialize the run queue
+void initRunQueue(RunQueue *queue) {
+    for (int i = 0; i < MLFQ_LEVELS; i++) {
+        initQueue(&queue->levels[i]);
+    }
+}
+
+// Function to release the storage of the run queue
+void freeRunQueue(RunQueue *queue) {
+    for (int i = 0; i < MLFQ_LEVELS; i++) {
+        freeQueue(&queue->levels[i]);
+    }
+}
+
+// Function to check if the run queue is empty
+bool isRunQueueEmpty(RunQueue *queue) {
+    for (int i = 0; i < MLFQ_LEVELS; i++) {
+        if (!isQueueEmpty(&queue->levels[i])) {
+            return false;
         }
-        fclose(file);
-    } else {
-        printf("Filename variable '%s' not found.\n", filename_variable);
     }
+    return true;
 }
 
-void executePrint(Process *process, char *variable) {
-    char *value = retrieveVariable(process, variable);
-    if (value != NULL) {
-        printf("%s\n", value);
-    } else {
-        printf("Variable '%s' not found.\n", variable);
+// Function to get the number of processes ready on a core, including the one it is running
+int coreLoad(Core *core) {
+    int load = core->runningProcess != NULL ? 1 : 0;
+    for (int i = 0; i < MLFQ_LEVELS; i++) {
+        load += core->readyQueue.levels[i].size;
     }
+    return load;
 }
 
-// Function to block a process
-void blockProcess(Process *process, const char *resource) {
-    process->pcb.process_state = BLOCKED;
-    strcpy(process->pcb.waiting_for_resource, resource);
-    enqueue(&blockedQueue, process);
-}
-
-// Function to unblock processes waiting for a specific resource
-void unblockProcesses(const char *resource) {
-    int size = blockedQueue.size;
-    for (int i = 0; i < size; i++) {
-        Process *process = dequeue(&blockedQueue);
-        if (strcmp(process->pcb.waiting_for_resource, resource) == 0) {
-            process->pcb.process_state = READY;
-            enqueue(&readyQueue, process);
-        } else {
-            enqueue(&blockedQueue, process);
+// Function to check if a core has nothing to run
+bool isCoreIdle(Core *core) {
+    return core->runningProcess == NULL && isRunQueueEmpty(&core->readyQueue);
+}
+
+// Function to get the number of instructions a process has left to execute
+int remainingInstructions(Process *process) {
+    return process->program->instruction_count - process->pcb.program_counter;
+}
+
+void addToFirstLevel(RunQueue *queue, Process *process) {
+    enqueue(&queue->levels[0], process);
+}
+
+Process* pickFirst(RunQueue *queue) {
+    return dequeue(&queue->levels[0]);
+}
+
+// Function to pick the process with the fewest remaining instructions
+Process* pickShortest(RunQueue *queue) {
+    ProcessQueue *level = &queue->levels[0];
+    int best = 0;
+    for (int i = 1; i < level->size; i++) {
+        Process *p = level->processes[(level->front + i) % level->capacity];
+        Process *b = level->processes[(level->front + best) % level->capacity];
+        if (remainingInstructions(p) < remainingInstructions(b)) {
+            best = i;
         }
     }
+    return removeFromQueue(level, best);
 }
 
-// Function to execute semWait instruction
-void executeSemWait(Process *process, char *resource) {
-    if (strcmp(resource, "userInput") == 0) {
-        if (user_input_mutex == 0) {
-            blockProcess(process, resource);
-        } else {
-            user_input_mutex = 0; // Acquire mutex
+// Function to pick the process with the highest response ratio (waiting + service) / service
+Process* pickHighestResponseRatio(RunQueue *queue) {
+    ProcessQueue *level = &queue->levels[0];
+    int best = 0;
+    double bestRatio = -1;
+    for (int i = 0; i < level->size; i++) {
+        Process *p = level->processes[(level->front + i) % level->capacity];
+        double service = remainingInstructions(p);
+        double ratio = (clockCycles - p->ready_since + service) / service;
+        if (ratio > bestRatio) {
+            best = i;
+            bestRatio = ratio;
         }
-    } else if (strcmp(resource, "file") == 0) {
-        if (file_mutex == 0) {
-            blockProcess(process, resource);
-        } else {
-            file_mutex = 0; // Acquire mutex
+    }
+    return removeFromQueue(level, best);
+}
+
+int unlimitedQuantum(Process *process) {
+    (void)process;
+    return -1;
+}
+
+int roundRobinQuantum(Process *process) {
+    (void)process;
+    return timeQuantum;
+}
+
+void ignoreExpiry(Process *process) {
+    (void)process;
+}
+
+void addToPriorityLevel(RunQueue *queue, Process *process) {
+    enqueue(&queue->levels[process->priority_level], process);
+}
+
+// Function to pick from the highest non-empty MLFQ level, after promoting processes that waited too long
+Process* pickHighestPriority(RunQueue *queue) {
+    for (int level = 1; level < MLFQ_LEVELS; level++) {
+        ProcessQueue *lower = &queue->levels[level];
+        // Processes are in the order they became ready, so the oldest are at the front
+        while (!isQueueEmpty(lower) && clockCycles - lower->processes[lower->front]->ready_since >= agingThreshold) {
+            Process *process = dequeue(lower);
+            process->priority_level = 0;
+            process->ready_since = clockCycles;
+            enqueue(&queue->levels[0], process);
         }
-    } else if (strcmp(resource, "userOutput") == 0) {
-        if (screen_output_mutex == 0) {
-            blockProcess(process, resource);
-        } else {
-            screen_output_mutex = 0; // Acquire mutex
+    }
+    for (int level = 0; level < MLFQ_LEVELS; level++) {
+        if (!isQueueEmpty(&queue->levels[level])) {
+            return dequeue(&queue->levels[level]);
         }
     }
+    return NULL;
+}
+
+int priorityLevelQuantum(Process *process) {
+    return mlfqQuanta[process->priority_level];
 }
 
-// Function to execute semSignal instruction
-void executeSemSignal(char *resource) {
-    if (strcmp(resource, "userInput") == 0) {
-        user_input_mutex = 1; // Release mutex
-    } else if (strcmp(resource, "file") == 0) {
-        file_mutex = 1; // Release mutex
-    } else if (strcmp(resource, "userOutput") == 0) {
-        screen_output_mutex = 1; // Release mutex
+// Function to move a process that used up its quantum one MLFQ level down
+void demote(Process *process) {
+    if (process->priority_level < MLFQ_LEVELS - 1) {
+        process->priority_level++;
     }
-    unblockProcesses(resource);
 }
 
-// Function to execute printFromTo instruction
-void executePrintFromTo(Process *process, char *startVar, char *endVar) {
-    char *startStr = retrieveVariable(process, startVar);
-    char *endStr = retrieveVariable(process, endVar);
-    if (startStr != NULL && endStr != NULL) {
-        int start = atoi(startStr);
-        int end = atoi(endStr);
-        for (int i = start; i <= end; i++) {
-            printf("%d ", i);
+Scheduler schedulers[] = {
+    {"fcfs", addToFirstLevel, pickFirst, unlimitedQuantum, ignoreExpiry},
+    {"rr", addToFirstLevel, pickFirst, roundRobinQuantum, ignoreExpiry},
+    {"sjf", addToFirstLevel, pickShortest, unlimitedQuantum, ignoreExpiry},
+    {"hrrn", addToFirstLevel, pickHighestResponseRatio, unlimitedQuantum, ignoreExpiry},
+    {"mlfq", addToPriorityLevel, pickHighestPriority, priorityLevelQuantum, demote}
+};
+
+Scheduler *scheduler = &schedulers[1]; // Round-robin by default
+
+// Function to find a scheduler by name, NULL if there is none
+Scheduler* findScheduler(const char *name) {
+    for (size_t i = 0; i < sizeof(schedulers) / sizeof(schedulers[0]); i++) {
+        if (strcmp(schedulers[i].name, name) == 0) {
+            return &schedulers[i];
         }
-        printf("\n");
-    } else {
-        printf("Error: Variables not found.\n");
     }
+    return NULL;
 }
 
-void executeProcess(Process *process) {
-    process->pcb.process_state = RUNNING;
-    char *line = process->instructions[process->pcb.program_counter];
-    printf("Executing instruction [%s] from Process %d at clock cycle %d\n", line, process->pcb.process_id, clockCycles);
-
-    // Tokenize the instruction line
-    char *instruction = strtok(line, " \n");
-    char *arg1 = strtok(NULL, " \n");
-    char *arg2 = strtok(NULL, " \n");
-    char *arg3 = strtok(NULL, "\n"); // To handle the `assign` case with `readFile`
-
-    if (strcmp(instruction, "print") == 0) {
-        executePrint(process, arg1); 
-    } else if (strcmp(instruction, "assign") == 0) {
-        // Handle the case where `arg2` and `arg3` should be concatenated
-        if (arg3 != NULL) {
-            char combinedValue[MAX_LINE_LENGTH];
-            snprintf(combinedValue, sizeof(combinedValue), "%s %s", arg2, arg3);
-            executeAssign(process, arg1, combinedValue);
-        } else {
-            executeAssign(process, arg1, arg2);
-        }
-    } else if (strcmp(instruction, "writeFile") == 0) {
-        executeWriteFile(process, arg1, arg2);
-    } else if (strcmp(instruction, "readFile") == 0) {
-        executeReadFile(process, arg1); 
-    } else if (strcmp(instruction, "printFromTo") == 0) {
-        executePrintFromTo(process, arg1, arg2);
-    } else if (strcmp(instruction, "semWait") == 0) {
-        executeSemWait(process, arg1);
-    } else if (strcmp(instruction, "semSignal") == 0) {
-        executeSemSignal(arg1);
-    } else {
-        printf("Unknown instruction: %s\n", instruction);
+// Function to write output of a process, buffered per core when cores run on several threads
+void processWrite(Process *process, const char *format, va_list args) {
+    if (threadCount == 1) {
+        vfprintf(outputFile, format, args);
+        return;
     }
 
-    // Remove executed instruction from the storage unit
-    if (strlen(process->instructions[process->pcb.program_counter]) > 0) {
-        strcpy(process->instructions[process->pcb.program_counter], ""); // Clear the executed instruction
+    Core *core = &cores[process->core];
+    va_list copy;
+    va_copy(copy, args);
+    int length = vsnprintf(NULL, 0, format, copy);
+    va_end(copy);
+    if (core->outputLength + length + 1 > core->outputCapacity) {
+        size_t capacity = core->outputCapacity == 0 ? 256 : core->outputCapacity;
+        while (core->outputLength + length + 1 > capacity) {
+            capacity *= 2;
+        }
+        core->output = (char *)realloc(core->output, capacity);
+        if (core->output == NULL) {
+            perror("Error growing output buffer");
+            exit(EXIT_FAILURE);
+        }
+        core->outputCapacity = capacity;
     }
+    vsnprintf(core->output + core->outputLength, length + 1, format, args);
+    core->outputLength += length;
+}
 
-    process->pcb.program_counter++;
-    process->pcb.cycles_remaining--;
-
-    if (process->pcb.process_state == RUNNING) {
-        if (process->pcb.program_counter >= MEMORY_SIZE || strlen(process->instructions[process->pcb.program_counter]) == 0) {
-            process->pcb.process_state = FINISHED;
-        } else if (process->pcb.cycles_remaining == 0) {
-            // Time quantum expired, move to end of ready queue
-            process->pcb.process_state = READY;
-            process->pcb.cycles_remaining = TIME_QUANTUM;
-            enqueue(&readyQueue, process);
+// Function to escape text for a JSON string, the result must be freed by the caller
+char *jsonEscape(const char *text) {
+    char *escaped = (char *)malloc(6 * strlen(text) + 1);
+    if (escaped == NULL) {
+        perror("Error escaping trace text");
+        exit(EXIT_FAILURE);
+    }
+    char *out = escaped;
+    for (const unsigned char *c = (const unsigned char *)text; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            *out++ = '\\';
+            *out++ = *c;
+        } else if (*c == '\n') {
+            *out++ = '\\';
+            *out++ = 'n';
+        } else if (*c < 0x20) {
+            out += sprintf(out, "\\u%04x", *c);
         } else {
-            process->pcb.process_state = READY;
+            *out++ = *c;
         }
     }
+    *out = '\0';
+    return escaped;
 }
 
-// Function to parse and execute instructions from a program file
-bool executeProgram(char *filename, Process *process) {
-    FILE *file = fopen(filename, "r");
-    if (file == NULL) {
-        perror("Error opening file");
-        printf("Error opening file: %s\n", filename); // Enhanced error message
-        return false;
+// Function to write an event of a process to the event log
+void processTrace(Process *process, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    processWrite(process, format, args);
+    va_end(args);
+}
+
+// Function to print output of a process, as an output event when writing the event log
+void processPrintf(Process *process, const char *format, ...) {
+    if (outputLevel == OUTPUT_SUMMARY || outputLevel == OUTPUT_SILENT) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    if (outputLevel == OUTPUT_TABLES) {
+        processWrite(process, format, args);
+        va_end(args);
+        return;
     }
 
-    char line[MAX_LINE_LENGTH];
-    int instruction_index = 0;
-    while (fgets(line, sizeof(line), file)) {
-        storeInstructions(process, line, instruction_index);
-        instruction_index++;
+    va_list copy;
+    va_copy(copy, args);
+    int length = vsnprintf(NULL, 0, format, copy);
+    va_end(copy);
+    char *text = (char *)malloc(length + 1);
+    if (text == NULL) {
+        perror("Error formatting process output");
+        exit(EXIT_FAILURE);
     }
+    vsnprintf(text, length + 1, format, args);
+    va_end(args);
+    char *escaped = jsonEscape(text);
+    processTrace(process, "{\"type\":\"output\",\"cycle\":%d,\"pid\":%d,\"text\":\"%s\"}\n",
+                 clockCycles, process->pcb.process_id, escaped);
+    free(escaped);
+    free(text);
+}
 
-    fclose(file);
-    return true;
+// Function to write an event of the main loop to the event log
+void traceEvent(const char *format, ...) {
+    if (outputLevel != OUTPUT_EVENTS) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    vfprintf(outputFile, format, args);
+    va_end(args);
 }
 
-void printQueue(const char *queueName, ProcessQueue *queue) {
-    printf("%s Queue:\n", queueName);
-    printf("+------------+-----------------------+\n");
-    printf("| Process ID | Current Instruction   |\n");
-    printf("+------------+-----------------------+\n");
-    for (int i = queue->front, count = 0; count < queue->size; i = (i + 1) % MAX_PROCESSES, count++) {
-        printf("| %-10d | %-21s |\n", queue->processes[i]->pcb.process_id, queue->processes[i]->instructions[queue->processes[i]->pcb.program_counter]);
+// Function to print and clear the buffered output of a core
+void flushCoreOutput(Core *core) {
+    if (core->outputLength > 0) {
+        PROFILE_START(timer);
+        fwrite(core->output, 1, core->outputLength, outputFile);
+        core->outputLength = 0;
+        PROFILE_STOP(timer, PROFILE_FLUSH);
     }
-    printf("+------------+-----------------------+\n");
 }
 
-void printStorageUnit(ProcessQueue *queue) {
-    printf("Memory Contents:\n");
-    printf("+------------+-----------------------+\n");
-    printf("| Process ID | Instructions          |\n");
-    printf("+------------+-----------------------+\n");
-    for (int i = queue->front, count = 0; count < queue->size; i = (i + 1) % MAX_PROCESSES, count++) {
-        Process *p = queue->processes[i];
-        for (int j = 0; j < MEMORY_SIZE && strlen(p->instructions[j]) > 0; j++) {
-            if (strlen(p->instructions[j]) > 0) { // Only print non-empty instructions
-                printf("| %-10d | %-21s |\n", p->pcb.process_id, p->instructions[j]);
-            }
+// Function to pick the core with the fewest ready processes for a newly arrived process
+int leastLoadedCore() {
+    int best = 0;
+    for (int i = 1; i < coreCount; i++) {
+        if (coreLoad(&cores[i]) < coreLoad(&cores[best])) {
+            best = i;
         }
     }
-    printf("+------------+-----------------------+\n");
+    return best;
 }
 
-void enqueueProcessToReadyQueue(Process *process) {
-    if (!isQueueFull(&readyQueue)) {
-        readyQueue.rear = (readyQueue.rear + 1) % MAX_PROCESSES;
-        readyQueue.processes[readyQueue.rear] = process;
-        readyQueue.size++;
-        printf("Process %d has arrived at clock cycle %d\n", process->pcb.process_id, clockCycles);
-        printf("Ready Queue:\n");
-        printf("+------------+-----------------------+\n");
-        printf("| Process ID | Current Instruction   |\n");
-        printf("+------------+-----------------------+\n");
-        printf("| %-10d | %-21s |\n", process->pcb.process_id, process->instructions[process->pcb.program_counter]);
-        printf("+------------+-----------------------+\n");
+// Function to let an idle core take a waiting process from the rear of the busiest core's ready queue
+Process* stealProcess(Core *thief) {
+    Core *victim = NULL;
+    int victimWaiting = 0;
+    for (int i = 0; i < coreCount; i++) {
+        int waiting = coreLoad(&cores[i]) - (cores[i].runningProcess != NULL ? 1 : 0);
+        if (&cores[i] != thief && waiting > victimWaiting) {
+            victim = &cores[i];
+            victimWaiting = waiting;
+        }
+    }
+    if (victim == NULL) {
+        return NULL;
+    }
+    // Take from the lowest priority level, leaving the victim the processes it would run next
+    for (int level = MLFQ_LEVELS - 1; level >= 0; level--) {
+        Process *process = dequeueRear(&victim->readyQueue.levels[level]);
+        if (process != NULL) {
+            process->core = thief->id;
+            thief->migrations++;
+            return process;
+        }
     }
+    return NULL;
 }
 
-int main(int argc, char *argv[]) {
-    if (argc < 2) {
-        printf("Usage: %s <arrival_time1> <program_file1> [<arrival_time2> <program_file2> ...]\n", argv[0]);
-        return 1;
+// Function to initialize memory as a single free region
+void initMemory() {
+    for (int i = 0; i < MEMORY_SIZE; i++) {
+        memory[i].type = WORD_FREE;
+        memory[i].owner = 0;
     }
+    memoryHoles[0].start = 0;
+    memoryHoles[0].size = MEMORY_SIZE;
+    memoryHoleCount = 1;
+}
 
-    // Initialize the ready queue, blocked queue, and storage unit
-    initQueue(&readyQueue);
-    initQueue(&blockedQueue);
-    initQueue(&storageQueue);
+// Function to get the number of memory words of the data segment of a process running a program
+int dataSize(Program *program) {
+    return PCB_WORDS + program->variable_count;
+}
 
-    // Create an array to store process programs and arrival times
-    Process *processes[MAX_PROCESSES];
-    int arrival_times[MAX_PROCESSES];
-    int process_count = 0;
+// Function to get the number of memory words swapping out a process would free
+int processSize(Process *process) {
+    // The code segment is only freed with the last resident process sharing it
+    return dataSize(process->program) + (process->program->references == 1 ? process->program->instruction_count : 0);
+}
 
-    // Parse the program files and arrival times
-    for (int i = 1; i < argc; i += 2) {
-        if (i + 1 >= argc) {
-            printf("Error: Missing program file for arrival time %s\n", argv[i]);
-            return 1;
+// Function to allocate a region of memory using first fit, returns its start or -1 if no region is large enough
+int allocateRegion(int size) {
+    for (int i = 0; i < memoryHoleCount; i++) {
+        if (memoryHoles[i].size >= size) {
+            int start = memoryHoles[i].start;
+            memoryHoles[i].start += size;
+            memoryHoles[i].size -= size;
+            if (memoryHoles[i].size == 0) {
+                memmove(&memoryHoles[i], &memoryHoles[i + 1], (memoryHoleCount - i - 1) * sizeof(MemoryHole));
+                memoryHoleCount--;
+            }
+            return start;
         }
+    }
+    return -1;
+}
 
-        int arrival_time = atoi(argv[i]);
-        char *filename = argv[i + 1];
+// Function to free a region of memory, merging it with adjacent free regions
+void freeRegion(int start, int size) {
+    for (int i = start; i < start + size; i++) {
+        memory[i].type = WORD_FREE;
+        memory[i].owner = 0;
+    }
 
-        Process *process = (Process *)malloc(sizeof(Process));
-        process->pcb.process_id = next_process_id++;
-        process->pcb.process_state = READY;
-        process->pcb.program_counter = 0;
-        process->pcb.cycles_remaining = TIME_QUANTUM;
-        process->arrival_time = arrival_time;
-        allocateMemory(process, 0, MEMORY_SIZE - 1);
-        if (!executeProgram(filename, process)) {
-            // If loading the program fails, free the allocated memory and break out of the loop
-            free(process);
-            printf("Failed to load program: %s\n", filename);
-            return 1;
-        }
+    int i = 0;
+    while (i < memoryHoleCount && memoryHoles[i].start < start) {
+        i++;
+    }
+    bool mergePrevious = i > 0 && memoryHoles[i - 1].start + memoryHoles[i - 1].size == start;
+    bool mergeNext = i < memoryHoleCount && start + size == memoryHoles[i].start;
+    if (mergePrevious && mergeNext) {
+        memoryHoles[i - 1].size += size + memoryHoles[i].size;
+        memmove(&memoryHoles[i], &memoryHoles[i + 1], (memoryHoleCount - i - 1) * sizeof(MemoryHole));
+        memoryHoleCount--;
+    } else if (mergePrevious) {
+        memoryHoles[i - 1].size += size;
+    } else if (mergeNext) {
+        memoryHoles[i].start = start;
+        memoryHoles[i].size += size;
+    } else {
+        memmove(&memoryHoles[i + 1], &memoryHoles[i], (memoryHoleCount - i) * sizeof(MemoryHole));
+        memoryHoles[i].start = start;
+        memoryHoles[i].size = size;
+        memoryHoleCount++;
+    }
+}
 
-        processes[process_count] = process;
-        arrival_times[process_count++] = arrival_time;
+// Function to drop a process's reference to the code segment of its program, freeing it after the last one
+void releaseCode(Process *process) {
+    Program *program = process->program;
+    program->references--;
+    if (program->references == 0 && program->code_base >= 0) {
+        freeRegion(program->code_base, program->instruction_count);
+        program->code_base = -1;
     }
+}
 
-    Process *executedProcess = NULL; // Track the currently executed process for removal
-    
-    // Execute processes from the ready queue
-    while (true) {
-        bool anyProcessActive = false;
-
-        // Check for process arrivals
-        for (int i = 0; i < process_count; i++) {
-            if (arrival_times[i] == clockCycles) {
-                enqueue(&storageQueue, processes[i]); // Enqueue arriving process into the storage unit
-                enqueueProcessToReadyQueue(processes[i]);
-            }
-        }
-
-        // Print the status of all queues
-        printQueue("Ready", &readyQueue);
-        printQueue("Blocked", &blockedQueue);
-        printStorageUnit(&storageQueue);
-
-        // Execute processes in the ready queue
-        while (!isQueueEmpty(&readyQueue)) {
-            printQueue("Ready", &readyQueue); // Print ready queue before executing each process
-            printQueue("Blocked", &blockedQueue); // Print blocked queue before executing each process
-            printStorageUnit(&storageQueue); // Print storage unit each cycle
-
-            Process *process = dequeue(&readyQueue);
-            if (process->pcb.process_state == READY) {
-                anyProcessActive = true;
-                                executedProcess = process;
-                executeProcess(process);
-                clockCycles++;
-                
-                // Check if new processes arrive during current execution
-                for (int j = 0; j < process_count; j++) {
-                    if (arrival_times[j] == clockCycles) {
-                        enqueue(&storageQueue, processes[j]); // Enqueue arriving process into the storage unit
-                        enqueueProcessToReadyQueue(processes[j]);
-                    }
-                }
+// Function to free the data segment of a process and its reference to the code segment
+void freeMemory(Process *process) {
+    PROFILE_START(timer);
+    int start = process->pcb.memory_lower_bound;
+    freeRegion(start, process->pcb.memory_upper_bound - start + 1);
+    releaseCode(process);
+    process->pcb.memory_lower_bound = -1;
+    process->pcb.memory_upper_bound = -1;
+    PROFILE_STOP(timer, PROFILE_MEMORY);
+}
 
-                // Remove the executed instruction from the storage unit
-                if (executedProcess != NULL) {
-                    int size = storageQueue.size;
-                    ProcessQueue tempQueue;
-                    initQueue(&tempQueue);
-
-                    for (int k = 0; k < size; k++) {
-                        Process *storageProcess = dequeue(&storageQueue);
-                        if (storageProcess->pcb.process_id == executedProcess->pcb.process_id) {
-                            strcpy(storageProcess->instructions[executedProcess->pcb.program_counter - 1], ""); // Clear the executed instruction
-                        }
-                        enqueue(&tempQueue, storageProcess);
-                    }
-
-                    // Transfer back to storageQueue to keep the original order
-                    for (int k = 0; k < size; k++) {
-                        enqueue(&storageQueue, dequeue(&tempQueue));
-                    }
-
-                    executedProcess = NULL;
-                }
+// Function to access a word of a process's memory, checking it lies within the process's bounds
+MemoryWord* processWord(Process *process, int offset) {
+    int address = process->pcb.memory_lower_bound + offset;
+    if (offset < 0 || address > process->pcb.memory_upper_bound) {
+        printf("Memory access violation by Process %d at offset %d\n", process->pcb.process_id, offset);
+        exit(EXIT_FAILURE);
+    }
+    return &memory[address];
+}
 
-                if (process->pcb.process_state == READY) {
-                    enqueue(&readyQueue, process);
-                } else if (process->pcb.process_state == BLOCKED || process->pcb.process_state == FINISHED) {
-                    if (process->pcb.process_state == FINISHED) {
-                        printf("Process %d has finished execution.\n", process->pcb.process_id);
-                        // Remove the finished process from the storage unit
-                        int size = storageQueue.size;
-                        ProcessQueue tempQueue;
-                        initQueue(&tempQueue);
-
-                        for (int k = 0; k < size; k++) {
-                            Process *storageProcess = dequeue(&storageQueue);
-                            if (storageProcess->pcb.process_id != process->pcb.process_id) {
-                                enqueue(&tempQueue, storageProcess);
-                            } else {
-                                free(storageProcess);
-                            }
-                        }
-
-                        // Transfer back to storageQueue to keep the original order
-                        for (int k = 0; k < tempQueue.size; k++) {
-                            enqueue(&storageQueue, dequeue(&tempQueue));
-                        }
-                    }
-                }
-            }
-        }
+// Function to access an instruction of a process's program, checking it lies within the code segment
+MemoryWord* instructionWord(Process *process, int pc) {
+    Program *program = process->program;
+    if (pc < 0 || pc >= program->instruction_count || program->code_base < 0) {
+        printf("Memory access violation by Process %d at instruction %d\n", process->pcb.process_id, pc);
+        exit(EXIT_FAILURE);
+    }
+    return &memory[program->code_base + pc];
+}
+
+// Function to save the PCB of a process into its memory
+void savePcb(Process *process) {
+    int fields[PCB_WORDS] = {
+        process->pcb.process_id,
+        process->pcb.process_state,
+        process->pcb.program_counter,
+        process->pcb.memory_lower_bound,
+        process->pcb.memory_upper_bound,
+        process->pcb.cycles_remaining,
+        process->pcb.waiting_for_resource
+    };
+    for (int i = 0; i < PCB_WORDS; i++) {
+        processWord(process, i)->field = fields[i];
+    }
+}
+
+// Function to refresh the PCB words of a resident process after its state changed outside of an instruction
+void syncPcb(Process *process) {
+    if (!process->swapped && process->pcb.memory_lower_bound >= 0) {
+        savePcb(process);
+    }
+}
+
+// Function to hand a ready process to the scheduler of the core it last ran on
+void makeReady(Process *process) {
+    Core *core = &cores[process->core];
+    pthread_mutex_lock(&core->readyLock);
+    process->pcb.process_state = READY;
+    process->ready_since = clockCycles;
+    syncPcb(process);
+    scheduler->add(&core->readyQueue, process);
+    pthread_mutex_unlock(&core->readyLock);
+}
+
+// Function to mark the PCB and variable words of a freshly allocated process
+void initProcessWords(Process *process) {
+    for (int i = 0; i < PCB_WORDS; i++) {
+        MemoryWord *word = processWord(process, i);
+        word->type = WORD_PCB;
+        word->owner = process->pcb.process_id;
+    }
+    for (int i = 0; i < process->program->variable_count; i++) {
+        MemoryWord *word = processWord(process, VARIABLES_OFFSET + i);
+        word->type = WORD_VARIABLE;
+        word->owner = process->pcb.process_id;
+        word->variable.type = VALUE_UNSET;
+        word->variable.text[0] = '\0';
+    }
+}
+
+// Swap file and statistics
+FILE *swapFile = NULL;
+long swapFileEnd = 0;
+int swapIns = 0;
+int swapOuts = 0;
+long swapBytesIn = 0;
+long swapBytesOut = 0;
+
+// Policy picking the resident process to swap out, returns NULL if there is none
+typedef Process* (*VictimPolicy)(Process *exclude);
+
+// Function to check if a process can be swapped out
+bool isSwappable(Process *process, Process *exclude) {
+    // Finished processes are still resident until the retire phase reclaims their memory,
+    // and a process waiting for console input keeps its memory for the line to be stored in
+    return process != exclude && !process->swapped && process->pcb.process_state != RUNNING
+        && process->pcb.process_state != FINISHED && process->pending_input == -1;
+}
+
+// Function to pick the least recently used resident process
+Process* selectLruVictim(Process *exclude) {
+    Process *victim = NULL;
+    for (Process *p = storageUnit.resident_head; p != NULL; p = p->resident_next) {
+        if (isSwappable(p, exclude) && (victim == NULL || p->last_used < victim->last_used)) {
+            victim = p;
+        }
+    }
+    return victim;
+}
+
+// Function to pick the resident process occupying the most memory
+Process* selectLargestVictim(Process *exclude) {
+    Process *victim = NULL;
+    for (Process *p = storageUnit.resident_head; p != NULL; p = p->resident_next) {
+        if (isSwappable(p, exclude) && (victim == NULL || processSize(p) > processSize(victim))) {
+            victim = p;
+        }
+    }
+    return victim;
+}
+
+VictimPolicy selectVictim = selectLruVictim;
+
+// Function to append raw bytes to a swap record
+void appendBytes(unsigned char *record, int *length, const void *data, int size) {
+    memcpy(record + *length, data, size);
+    *length += size;
+}
+
+// Function to append a string to a swap record, prefixed with its length
+void appendString(unsigned char *record, int *length, const char *text) {
+    unsigned char size = (unsigned char)strlen(text);
+    appendBytes(record, length, &size, 1);
+    appendBytes(record, length, text, size);
+}
+
+// Function to read a string from a swap record
+void readString(const unsigned char *record, int *position, char *text) {
+    unsigned char size = record[(*position)++];
+    memcpy(text, record + *position, size);
+    text[size] = '\0';
+    *position += size;
+}
+
+// Function to write a process's PCB and variables to the swap file and free its memory
+void swapOut(Process *process) {
+    // Instructions are not written, the decoded program is kept and reloaded with the code segment
+    unsigned char record[PCB_WORDS * sizeof(int) + MAX_VARIABLES_PER_PROCESS * (MAX_LINE_LENGTH + 2)];
+    int length = 0;
+    PROFILE_START(timer);
+
+    savePcb(process);
+    for (int i = 0; i < PCB_WORDS; i++) {
+        appendBytes(record, &length, &processWord(process, i)->field, sizeof(int));
+    }
+    for (int i = 0; i < process->program->variable_count; i++) {
+        MemoryWord *word = processWord(process, VARIABLES_OFFSET + i);
+        unsigned char type = (unsigned char)word->variable.type;
+        appendBytes(record, &length, &type, 1);
+        appendString(record, &length, word->variable.text);
+    }
+
+    if (swapFile == NULL) {
+        swapFile = tmpfile();
+        if (swapFile == NULL) {
+            perror("Error creating swap file");
+            exit(EXIT_FAILURE);
+        }
+    }
+    // Reuse the process's slot if the record still fits, otherwise move it to the end of the file
+    if (process->swap_offset < 0 || length > process->swap_capacity) {
+        process->swap_offset = swapFileEnd;
+        process->swap_capacity = length;
+        swapFileEnd += length;
+    }
+    if (fseek(swapFile, process->swap_offset, SEEK_SET) != 0 || fwrite(record, 1, length, swapFile) != (size_t)length) {
+        perror("Error writing swap file");
+        exit(EXIT_FAILURE);
+    }
+    process->swap_size = length;
+
+    if (outputLevel == OUTPUT_TABLES) {
+        fprintf(outputFile, "Process %d swapped out to disk at clock cycle %d (%d bytes)\n", process->pcb.process_id, clockCycles, length);
+    }
+    traceEvent("{\"type\":\"swap_out\",\"cycle\":%d,\"pid\":%d,\"bytes\":%d}\n", clockCycles, process->pcb.process_id, length);
+    freeMemory(process);
+    removeResident(&storageUnit, process);
+    process->swapped = true;
+    swapOuts++;
+    swapBytesOut += length;
+    PROFILE_STOP(timer, PROFILE_SWAP);
+}
+
+// Function to allocate a region of memory for a process, swapping out victims until a large enough region is free
+int allocateWithSwapping(Process *process, int size) {
+    int start;
+    while ((start = allocateRegion(size)) < 0) {
+        Process *victim = selectVictim(process);
+        if (victim == NULL) {
+            return -1;
+        }
+        swapOut(victim);
+    }
+    return start;
+}
+
+// Function to map the code segment of a process's program, loading it for the first resident process using it
+bool acquireCode(Process *process) {
+    Program *program = process->program;
+    if (program->references == 0 && program->instruction_count > 0) {
+        int start = allocateWithSwapping(process, program->instruction_count);
+        if (start < 0) {
+            return false;
+        }
+        memcpy(&memory[start], program->code, program->instruction_count * sizeof(MemoryWord));
+        program->code_base = start;
+    }
+    program->references++;
+    return true;
+}
+
+// Function to allocate the code and data segments of a process, returns false if there is not enough memory
+bool allocateMemory(Process *process) {
+    // The code segment comes first, so swapping for the data segment never evicts it
+    if (!acquireCode(process)) {
+        return false;
+    }
+    int start = allocateWithSwapping(process, dataSize(process->program));
+    if (start < 0) {
+        releaseCode(process);
+        return false;
+    }
+    process->pcb.memory_lower_bound = start;
+    process->pcb.memory_upper_bound = start + dataSize(process->program) - 1;
+    return true;
+}
+
+// Function to read a swapped out process back into memory, returns false if there is not enough free memory
+bool swapIn(Process *process) {
+    unsigned char record[PCB_WORDS * sizeof(int) + MAX_VARIABLES_PER_PROCESS * (MAX_LINE_LENGTH + 2)];
+    PROFILE_START(timer);
+    if (fseek(swapFile, process->swap_offset, SEEK_SET) != 0 || fread(record, 1, process->swap_size, swapFile) != (size_t)process->swap_size) {
+        perror("Error reading swap file");
+        exit(EXIT_FAILURE);
+    }
+    if (!allocateMemory(process)) {
+        PROFILE_STOP(timer, PROFILE_SWAP);
+        return false;
+    }
+    initProcessWords(process);
+
+    // The PCB of the record is skipped, the process may have been woken or requeued while it was on disk,
+    // so the PCB kept by the process table is current and is written to the new region below
+    int position = PCB_WORDS * sizeof(int);
+
+    for (int i = 0; i < process->program->variable_count; i++) {
+        MemoryWord *word = processWord(process, VARIABLES_OFFSET + i);
+        word->variable.type = (ValueType)record[position++];
+        readString(record, &position, word->variable.text);
+        if (word->variable.type == VALUE_INTEGER) {
+            word->variable.number = atoi(word->variable.text);
+        }
+    }
+    savePcb(process);
+
+    if (outputLevel == OUTPUT_TABLES) {
+        fprintf(outputFile, "Process %d swapped in from disk at clock cycle %d (%d bytes)\n", process->pcb.process_id, clockCycles, process->swap_size);
+    }
+    traceEvent("{\"type\":\"swap_in\",\"cycle\":%d,\"pid\":%d,\"bytes\":%d}\n", clockCycles, process->pcb.process_id, process->swap_size);
+    process->swapped = false;
+    addResident(&storageUnit, process);
+    process->last_used = clockCycles;
+    swapIns++;
+    swapBytesIn += process->swap_size;
+    PROFILE_STOP(timer, PROFILE_SWAP);
+    return true;
+}
+
+// Function to load a process into memory, returns false if there is not enough free memory
+bool loadProcess(Process *process) {
+    PROFILE_START(timer);
+    if (!allocateMemory(process)) {
+        PROFILE_STOP(timer, PROFILE_MEMORY);
+        return false;
+    }
+    initProcessWords(process);
+    savePcb(process);
+    process->last_used = clockCycles;
+    PROFILE_STOP(timer, PROFILE_MEMORY);
+    return true;
+}
+
+// Function to get the source text of the instruction a process will execute next
+const char* currentInstruction(Process *process) {
+    if (process->pcb.program_counter >= process->program->instruction_count) {
+        return "";
+    }
+    if (process->swapped) {
+        return "(swapped out)";
+    }
+    return instructionWord(process, process->pcb.program_counter)->instruction.text;
+}
+
+// Function to store variables in memory for a process, parsing integer values once
+void storeVariables(Process *process, int variable, const char *value) {
+    MemoryWord *word = processWord(process, VARIABLES_OFFSET + variable);
+    size_t length = strnlen(value, MAX_LINE_LENGTH - 1);
+    memcpy(word->variable.text, value, length);
+    word->variable.text[length] = '\0';
+
+    char *end;
+    long number = strtol(word->variable.text, &end, 10);
+    if (length > 0 && *end == '\0' && number >= INT_MIN && number <= INT_MAX) {
+        word->variable.type = VALUE_INTEGER;
+        word->variable.number = (int)number;
+    } else {
+        word->variable.type = VALUE_STRING;
+    }
+}
+
+// Function to get the value of a variable, returns NULL if it is unset or empty
+char* retrieveVariable(Process *process, int variable) {
+    MemoryWord *word = processWord(process, VARIABLES_OFFSET + variable);
+    if (word->variable.type == VALUE_UNSET || word->variable.text[0] == '\0') {
+        return NULL;
+    }
+    return word->variable.text;
+}
+
+// Function to get the integer value of a variable, returns false if it is unset or not an integer
+bool retrieveInteger(Process *process, int variable, int *number) {
+    MemoryWord *word = processWord(process, VARIABLES_OFFSET + variable);
+    if (word->variable.type != VALUE_INTEGER) {
+        return false;
+    }
+    *number = word->variable.number;
+    return true;
+}
+
+void executeAssign(Process *process, int variable, const char *value) {
+    storeVariables(process, variable, value);
+}
+
+// Result of asking an input source for a value
+typedef enum {
+    INPUT_READ,
+    INPUT_EXHAUSTED, // The source has no more values
+    INPUT_PENDING // The value is not there yet, the process waits for it
+} InputStatus;
+
+// Structure to represent a source of the values of assign x input
+typedef struct {
+    const char *name;
+    InputStatus (*read)(Process *process, char *value, int size);
+} InputProvider;
+
+// Structure to represent a value read by a process, as kept in an input log
+typedef struct {
+    int process_id;
+    char value[MAX_LINE_LENGTH];
+} InputRecord;
+
+const char *inputDirectory; // Directory of the per-process input files
+unsigned int inputSeed = 1; // Seed of the random input provider
+InputRecord *replayRecords; // Input log being replayed
+int replayCount = 0;
+FILE *inputLog = NULL; // Log the values read are recorded to, NULL if they are not recorded
+
+// Function to read a line of a file without its newline, returns false at the end of the file
+bool readInputLine(FILE *file, char *value, int size) {
+    if (fgets(value, size, file) == NULL) {
+        return false;
+    }
+    value[strcspn(value, "\n")] = '\0'; // Remove newline character
+    return true;
+}
+
+// Console input read so far, taken from stdin without blocking so the simulation runs on while a line is typed
+char consoleBuffer[MAX_LINE_LENGTH];
+int consoleLength = 0;
+bool consoleClosed = false; // Stdin has ended, no more lines will come
+int consoleReaders = 0; // Processes waiting for a line, they get the lines in request order
+
+// Function to check if the console buffer holds a value of up to size - 1 characters, like fgets would read it
+bool hasConsoleLine(int size) {
+    int limit = consoleLength < size - 1 ? consoleLength : size - 1;
+    return memchr(consoleBuffer, '\n', limit) != NULL || consoleLength >= size - 1 || (consoleClosed && consoleLength > 0);
+}
+
+// Function to read what has been typed on the console into the buffer, with wait it blocks until a line is there
+void pollConsole(bool wait) {
+    while (!consoleClosed && !hasConsoleLine(MAX_LINE_LENGTH)) {
+        struct pollfd descriptor = {.fd = STDIN_FILENO, .events = POLLIN};
+        if (poll(&descriptor, 1, wait ? -1 : 0) <= 0) {
+            return; // Nothing typed yet, or interrupted by a signal
+        }
+        ssize_t count = read(STDIN_FILENO, consoleBuffer + consoleLength, sizeof(consoleBuffer) - consoleLength);
+        if (count < 0 && errno == EINTR) {
+            return;
+        }
+        if (count <= 0) {
+            consoleClosed = true;
+            return;
+        }
+        consoleLength += count;
+    }
+}
+
+// Function to take the next line out of the console buffer without its newline, returns false once stdin has ended
+bool takeConsoleLine(char *value, int size) {
+    if (consoleLength == 0) {
+        return false;
+    }
+    int limit = consoleLength < size - 1 ? consoleLength : size - 1;
+    char *newline = (char *)memchr(consoleBuffer, '\n', limit);
+    int length = newline != NULL ? (int)(newline - consoleBuffer) : limit;
+    memcpy(value, consoleBuffer, length);
+    value[length] = '\0';
+    int used = newline != NULL ? length + 1 : length;
+    memmove(consoleBuffer, consoleBuffer + used, consoleLength - used);
+    consoleLength -= used;
+    return true;
+}
+
+// Function to read a value from the console, pending if no line has been typed yet or earlier readers still wait
+InputStatus readStdinInput(Process *process, char *value, int size) {
+    pthread_mutex_lock(&outputLock);
+    pollConsole(false);
+    InputStatus status = INPUT_PENDING;
+    if (consoleReaders == 0 && (consoleClosed || hasConsoleLine(size))) {
+        status = takeConsoleLine(value, size) ? INPUT_READ : INPUT_EXHAUSTED;
+    } else {
+        consoleReaders++;
+        // The prompt has to be shown while the process waits, so the output of this cycle so far is printed now
+        if (threadCount > 1) {
+            for (int i = deterministic ? 0 : process->core; i <= process->core; i++) {
+                flushCoreOutput(&cores[i]);
+            }
+        }
+        fflush(outputFile);
+    }
+    pthread_mutex_unlock(&outputLock);
+    return status;
+}
+
+// Function to read the next value of a process from its own input file, <directory>/<process ID>.txt
+InputStatus readFileInput(Process *process, char *value, int size) {
+    if (process->input_file == NULL) {
+        char path[MAX_LINE_LENGTH + 16];
+        snprintf(path, sizeof(path), "%s/%d.txt", inputDirectory, process->pcb.process_id);
+        process->input_file = fopen(path, "r");
+        if (process->input_file == NULL) {
+            processPrintf(process, "Error: Cannot read input file %s: %s\n", path, strerror(errno));
+            return INPUT_EXHAUSTED;
+        }
+    }
+    return readInputLine(process->input_file, value, size) ? INPUT_READ : INPUT_EXHAUSTED;
+}
+
+// Function to generate a value, each process has its own sequence so the values do not depend on scheduling
+InputStatus readRandomInput(Process *process, char *value, int size) {
+    if (process->input_seed == 0) {
+        process->input_seed = (inputSeed ^ (unsigned int)process->pcb.process_id * 2654435761u) | 1;
+    }
+    snprintf(value, size, "%d", rand_r(&process->input_seed) % 100 + 1);
+    return INPUT_READ;
+}
+
+// Function to read the next value a process read in the run the replayed log was recorded from
+InputStatus readReplayInput(Process *process, char *value, int size) {
+    while (process->input_position < replayCount) {
+        InputRecord *record = &replayRecords[process->input_position++];
+        if (record->process_id == process->pcb.process_id) {
+            snprintf(value, size, "%s", record->value);
+            return INPUT_READ;
+        }
+    }
+    return INPUT_EXHAUSTED;
+}
+
+InputProvider stdinInput = {"stdin", readStdinInput};
+InputProvider fileInput = {"file", readFileInput};
+InputProvider randomInput = {"random", readRandomInput};
+InputProvider replayInput = {"replay", readReplayInput};
+InputProvider *inputProvider = &stdinInput;
+
+// Function to load an input log to replay, returns false if it cannot be read
+bool loadReplayLog(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        perror("Error opening input log");
+        return false;
+    }
+    char line[MAX_LINE_LENGTH + 16];
+    int capacity = 0;
+    while (readInputLine(file, line, sizeof(line))) {
+        char *separator = strchr(line, '\t');
+        if (separator == NULL) {
+            continue; // Not a record
+        }
+        if (replayCount == capacity) {
+            capacity = capacity == 0 ? 16 : 2 * capacity;
+            replayRecords = (InputRecord *)realloc(replayRecords, capacity * sizeof(InputRecord));
+            if (replayRecords == NULL) {
+                perror("Error growing input log");
+                exit(EXIT_FAILURE);
+            }
+        }
+        replayRecords[replayCount].process_id = atoi(line);
+        snprintf(replayRecords[replayCount].value, MAX_LINE_LENGTH, "%s", separator + 1);
+        replayCount++;
+    }
+    fclose(file);
+    return true;
+}
+
+// Function to execute assign x input instruction, returns true as the console is always asked
+bool executeAssignInput(Process *process, int variable) {
+    char value[MAX_LINE_LENGTH] = "";
+    processPrintf(process, "Please enter a value for variable %s: ", process->program->variable_names[variable]);
+    InputStatus status = inputProvider->read(process, value, sizeof(value));
+    if (status == INPUT_PENDING) {
+        process->pending_input = variable; // Stored once the console has a line for it
+        return true;
+    }
+    if (status == INPUT_EXHAUSTED) {
+        value[0] = '\0'; // Out of input, the variable is left empty
+    }
+    if (inputLog != NULL) {
+        pthread_mutex_lock(&outputLock);
+        fprintf(inputLog, "%d\t%s\n", process->pcb.process_id, value);
+        pthread_mutex_unlock(&outputLock);
+    }
+    storeVariables(process, variable, value);
+    return true; // The console was asked even when the input ran out
+}
+
+// Structure to represent a file cached in memory, read from disk once and written back later
+typedef struct {
+    char *path;
+    char *data; // Contents, NUL terminated
+    size_t size;
+    bool dirty; // Written since it was last flushed to disk
+} CachedFile;
+
+// When cached writes reach disk
+typedef enum {
+    SYNC_AT_EXIT, // Write-back once the simulation ends
+    SYNC_ON_WRITE // Write-through on every writeFile
+} SyncPolicy;
+
+CachedFile *fileCache;
+int fileCacheCount = 0;
+int fileCacheCapacity = 0;
+SyncPolicy syncPolicy = SYNC_AT_EXIT;
+int fileCacheHits = 0;
+int fileCacheMisses = 0;
+int fileWrites = 0;
+int fileFlushes = 0;
+
+// Function to find a file in the cache, returns NULL if it is not cached
+CachedFile* findCachedFile(const char *path) {
+    for (int i = 0; i < fileCacheCount; i++) {
+        if (strcmp(fileCache[i].path, path) == 0) {
+            return &fileCache[i];
+        }
+    }
+    return NULL;
+}
+
+// Function to add an empty file to the cache
+CachedFile* addCachedFile(const char *path) {
+    if (fileCacheCount == fileCacheCapacity) {
+        fileCacheCapacity = fileCacheCapacity == 0 ? 8 : 2 * fileCacheCapacity;
+        fileCache = (CachedFile *)realloc(fileCache, fileCacheCapacity * sizeof(CachedFile));
+        if (fileCache == NULL) {
+            perror("Error growing file cache");
+            exit(EXIT_FAILURE);
+        }
+    }
+    CachedFile *file = &fileCache[fileCacheCount++];
+    file->path = strdup(path);
+    file->data = strdup("");
+    file->size = 0;
+    file->dirty = false;
+    return file;
+}
+
+// Function to get the contents of a file, reading it from disk on a cache miss, returns NULL and sets errno on failure
+CachedFile* readCachedFile(const char *path) {
+    CachedFile *cached = findCachedFile(path);
+    if (cached != NULL) {
+        fileCacheHits++;
+        return cached;
+    }
+    fileCacheMisses++;
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL; // Missing files are not cached, a later writeFile may create them
+    }
+    char *data = NULL;
+    size_t size = 0;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        long length = ftell(file);
+        if (length >= 0 && fseek(file, 0, SEEK_SET) == 0) {
+            data = (char *)malloc(length + 1);
+            if (data == NULL) {
+                perror("Error allocating file cache");
+                exit(EXIT_FAILURE);
+            }
+            size = fread(data, 1, length, file);
+        }
+    }
+    bool failed = data == NULL || ferror(file);
+    int error = errno;
+    fclose(file);
+    if (failed) {
+        free(data);
+        errno = error != 0 ? error : EIO;
+        return NULL;
+    }
+    data[size] = '\0';
+    cached = addCachedFile(path);
+    free(cached->data);
+    cached->data = data;
+    cached->size = size;
+    return cached;
+}
+
+// Function to write a cached file back to disk, returns false and sets errno on failure
+bool flushCachedFile(CachedFile *cached) {
+    FILE *file = fopen(cached->path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+    bool written = fwrite(cached->data, 1, cached->size, file) == cached->size;
+    if (fclose(file) != 0 || !written) {
+        return false;
+    }
+    cached->dirty = false;
+    fileFlushes++;
+    return true;
+}
+
+// Function to write every dirty cached file back to disk and release the cache
+void flushFileCache() {
+    for (int i = 0; i < fileCacheCount; i++) {
+        if (fileCache[i].dirty && !flushCachedFile(&fileCache[i])) {
+            printf("Error: Cannot write file %s: %s\n", fileCache[i].path, strerror(errno));
+        }
+        free(fileCache[i].path);
+        free(fileCache[i].data);
+    }
+    free(fileCache);
+    fileCache = NULL;
+    fileCacheCount = 0;
+    fileCacheCapacity = 0;
+}
+
+// Function to report a failed file operation to a process, which carries on with its next instruction
+void fileError(Process *process, const char *operation, const char *path, int error) {
+    process->metrics.io_errors++;
+    processPrintf(process, "Error: Cannot %s file %s: %s\n", operation, path, strerror(error));
+}
+
+// Function to execute assign x readFile y instruction, returns true if the file was read
+bool executeAssignReadFile(Process *process, int variable, int filename_variable) {
+    char *filename = retrieveVariable(process, filename_variable);
+    if (filename == NULL) {
+        processPrintf(process, "Filename variable '%s' not found.\n", process->program->variable_names[filename_variable]);
+        return false;
+    }
+    pthread_mutex_lock(&fileLock);
+    CachedFile *file = readCachedFile(filename);
+    if (file == NULL) {
+        int error = errno;
+        pthread_mutex_unlock(&fileLock);
+        fileError(process, "read", filename, error);
+        return false;
+    }
+    // The variable gets the first line of the file
+    char fileData[MAX_LINE_LENGTH];
+    size_t length = strcspn(file->data, "\n");
+    length = length < sizeof(fileData) - 1 ? length : sizeof(fileData) - 1;
+    memcpy(fileData, file->data, length);
+    fileData[length] = '\0';
+    pthread_mutex_unlock(&fileLock);
+    storeVariables(process, variable, fileData);
+    return true;
+}
+
+// Function to execute writeFile instruction, returns true if the file was written
+bool executeWriteFile(Process *process, int filename_variable, int data_variable) {
+    char *filename = retrieveVariable(process, filename_variable);
+    char *data = retrieveVariable(process, data_variable);
+    if (filename != NULL && data != NULL) {
+        processPrintf(process, "Creating file: %s\n", filename); // Print the filename
+        pthread_mutex_lock(&fileLock);
+        // The file is replaced, so its old contents are never read from disk
+        CachedFile *file = findCachedFile(filename);
+        if (file == NULL) {
+            file = addCachedFile(filename);
+        }
+        free(file->data);
+        file->data = strdup(data);
+        file->size = strlen(data);
+        file->dirty = true;
+        fileWrites++;
+        bool flushed = syncPolicy == SYNC_AT_EXIT || flushCachedFile(file);
+        int error = errno;
+        if (!flushed) {
+            file->dirty = false; // Reported to the process now rather than again at exit
+        }
+        pthread_mutex_unlock(&fileLock);
+        if (!flushed) {
+            fileError(process, "write", filename, error);
+        }
+        return flushed;
+    }
+    processPrintf(process, "Error: Invalid filename or data.\n");
+    return false;
+}
+
+// Function to execute readFile instruction, returns true if the file was read
+bool executeReadFile(Process *process, int filename_variable) {
+    char *filename = retrieveVariable(process, filename_variable);
+    if (filename != NULL) {
+        pthread_mutex_lock(&fileLock);
+        CachedFile *file = readCachedFile(filename);
+        if (file == NULL) {
+            int error = errno;
+            pthread_mutex_unlock(&fileLock);
+            fileError(process, "read", filename, error);
+            return false;
+        }
+        processPrintf(process, "%s", file->data);
+        pthread_mutex_unlock(&fileLock);
+        return true;
+    }
+    processPrintf(process, "Filename variable '%s' not found.\n", process->program->variable_names[filename_variable]);
+    return false;
+}
+
+void executePrint(Process *process, int variable) {
+    char *value = retrieveVariable(process, variable);
+    if (value != NULL) {
+        processPrintf(process, "%s\n", value);
+    } else {
+        processPrintf(process, "Variable '%s' not found.\n", process->program->variable_names[variable]);
+    }
+}
+
+// Function to record that a process holds a unit of a semaphore
+void addHolder(Semaphore *semaphore, Process *process) {
+    enqueue(&semaphore->holders, process);
+}
+
+// Function to drop one unit of a semaphore held by a process, returns false if it holds none
+bool removeHolder(Semaphore *semaphore, Process *process) {
+    int position = queuePosition(&semaphore->holders, process);
+    if (position < 0) {
+        return false;
+    }
+    removeFromQueue(&semaphore->holders, position);
+    return true;
+}
+
+// Function to block a process in the wait queue of a semaphore
+void blockProcess(Process *process, Semaphore *semaphore) {
+    process->pcb.process_state = BLOCKED;
+    process->pcb.waiting_for_resource = semaphore - semaphores;
+    process->metrics.blocked_since = clockCycles + 1; // Blocked from the next cycle on
+    enqueue(&semaphore->waiters[priorityWaitQueues ? process->priority_level : 0], process);
+    semaphore->waiterCount++;
+}
+
+// Function to unblock the next waiter of a semaphore, it is made ready once every core has executed
+void unblockProcess(Semaphore *semaphore) {
+    for (int level = 0; level < MLFQ_LEVELS; level++) {
+        if (!isQueueEmpty(&semaphore->waiters[level])) {
+            Process *process = dequeue(&semaphore->waiters[level]);
+            semaphore->waiterCount--;
+            addHolder(semaphore, process); // The waiter takes over the released unit
+            pthread_mutex_lock(&wakeLock);
+            enqueue(&wakeQueue, process);
+            pthread_mutex_unlock(&wakeLock);
+            return;
+        }
+    }
+}
+
+// Function to add the time a process has been blocked on its semaphore to its statistics
+void addBlockedCycles(Process *process) {
+    ProcessMetrics *metrics = &process->metrics;
+    if (metrics->blocked_cycles == NULL) {
+        metrics->blocked_cycles = (int *)calloc(semaphoreCount, sizeof(int));
+        if (metrics->blocked_cycles == NULL) {
+            perror("Error allocating process statistics");
+            exit(EXIT_FAILURE);
+        }
+    }
+    metrics->blocked_cycles[process->pcb.waiting_for_resource] += clockCycles - metrics->blocked_since;
+}
+
+// Function to make the processes unblocked in this cycle ready
+void wakeProcesses() {
+    while (!isQueueEmpty(&wakeQueue)) {
+        Process *process = dequeue(&wakeQueue);
+        addBlockedCycles(process);
+        process->pcb.waiting_for_resource = -1;
+        process->in_deadlock = false;
+        makeReady(process);
+    }
+}
+
+// Function to execute semWait instruction
+void executeSemWait(Process *process, int semaphore_id) {
+    Semaphore *semaphore = &semaphores[semaphore_id];
+    pthread_mutex_lock(&semaphore->lock);
+    if (semaphore->value == 0) {
+        blockProcess(process, semaphore);
+    } else {
+        semaphore->value--; // Acquire semaphore
+        addHolder(semaphore, process);
+    }
+    pthread_mutex_unlock(&semaphore->lock);
+}
+
+// Function to execute semSignal instruction, a waiter takes over the released unit directly
+void executeSemSignal(Process *process, int semaphore_id) {
+    Semaphore *semaphore = &semaphores[semaphore_id];
+    pthread_mutex_lock(&semaphore->lock);
+    removeHolder(semaphore, process); // Signalling a unit the process does not hold just adds one
+    if (semaphore->waiterCount > 0) {
+        unblockProcess(semaphore);
+    } else {
+        semaphore->value++; // Release semaphore
+    }
+    pthread_mutex_unlock(&semaphore->lock);
+}
+
+// Function to get the number of processes blocked on any semaphore
+int blockedProcessCount() {
+    int count = 0;
+    for (int i = 0; i < semaphoreCount; i++) {
+        count += semaphores[i].waiterCount;
+    }
+    return count;
+}
+
+// Function to get the device an instruction uses, -1 if it uses none
+int instructionDevice(Instruction *instruction) {
+    switch (instruction->opcode) {
+    case OP_ASSIGN_INPUT:
+        return DEVICE_CONSOLE;
+    case OP_ASSIGN_READFILE:
+    case OP_WRITE_FILE:
+    case OP_READ_FILE:
+        return DEVICE_DISK;
+    default:
+        return -1;
+    }
+}
+
+// Function to execute printFromTo instruction
+void executePrintFromTo(Process *process, int startVar, int endVar) {
+    int start, end;
+    if (retrieveInteger(process, startVar, &start) && retrieveInteger(process, endVar, &end)) {
+        for (int i = start; i <= end; i++) {
+            processPrintf(process, "%d ", i);
+        }
+        processPrintf(process, "\n");
+    } else if (retrieveVariable(process, startVar) != NULL && retrieveVariable(process, endVar) != NULL) {
+        processPrintf(process, "Error: printFromTo needs integer values.\n");
+    } else {
+        processPrintf(process, "Error: Variables not found.\n");
+    }
+}
+
+void executeProcess(Process *process) {
+    process->pcb.process_state = RUNNING;
+    process->metrics.cpu_cycles++;
+    MemoryWord *word = instructionWord(process, process->pcb.program_counter);
+    const char *line = word->instruction.text;
+    Instruction *instruction = &word->instruction.decoded;
+    if (outputLevel == OUTPUT_EVENTS) {
+        processTrace(process, "{\"type\":\"exec\",\"cycle\":%d,\"pid\":%d,\"core\":%d,\"pc\":%d}\n",
+                     clockCycles, process->pcb.process_id, process->core, process->pcb.program_counter);
+    } else if (coreCount == 1) {
+        processPrintf(process, "Executing instruction [%s] from Process %d at clock cycle %d\n", line, process->pcb.process_id, clockCycles);
+    } else {
+        processPrintf(process, "Executing instruction [%s] from Process %d at clock cycle %d on core %d\n", line, process->pcb.process_id, clockCycles, process->core);
+    }
+
+    PROFILE_START(timer);
+    bool issued = false; // A request reached the instruction's device
+    switch (instruction->opcode) {
+    case OP_PRINT:
+        executePrint(process, instruction->operand1);
+        break;
+    case OP_ASSIGN:
+        executeAssign(process, instruction->operand1, line + instruction->operand2);
+        break;
+    case OP_ASSIGN_INPUT:
+        issued = executeAssignInput(process, instruction->operand1);
+        break;
+    case OP_ASSIGN_READFILE:
+        issued = executeAssignReadFile(process, instruction->operand1, instruction->operand2);
+        break;
+    case OP_WRITE_FILE:
+        issued = executeWriteFile(process, instruction->operand1, instruction->operand2);
+        break;
+    case OP_READ_FILE:
+        issued = executeReadFile(process, instruction->operand1);
+        break;
+    case OP_PRINT_FROM_TO:
+        executePrintFromTo(process, instruction->operand1, instruction->operand2);
+        break;
+    case OP_SEM_WAIT:
+        executeSemWait(process, process->program->semaphores[instruction->operand1].id);
+        break;
+    case OP_SEM_SIGNAL:
+        executeSemSignal(process, process->program->semaphores[instruction->operand1].id);
+        break;
+    default:
+        break;
+    }
+    PROFILE_STOP(timer, PROFILE_INSTRUCTION + instruction->opcode);
+
+    // The operation is done, but the process waits until its device would have completed it,
+    // an operation that failed before reaching the device does not wait for it, a console read waits for its line
+    int device = issued ? instructionDevice(instruction) : -1;
+    if (device != -1 && (devices[device].latency > 0 || process->pending_input != -1)) {
+        process->pcb.process_state = BLOCKED;
+        process->io_device = device;
+        process->metrics.blocked_since = clockCycles + 1; // Blocked from the next cycle on
+    }
+
+    process->pcb.program_counter++;
+    if (process->pcb.cycles_remaining > 0) {
+        process->pcb.cycles_remaining--;
+    }
+
+    // A process that is still running keeps the CPU until its quantum expires
+    if (process->pcb.process_state == RUNNING && process->pcb.program_counter >= process->program->instruction_count) {
+        process->pcb.process_state = FINISHED;
+    }
+    savePcb(process);
+}
+
+// Function to hash a name with FNV-1a
+unsigned int hashName(const char *name) {
+    unsigned int hash = 2166136261u;
+    for (const char *p = name; *p != '\0'; p++) {
+        hash = (hash ^ (unsigned char)*p) * 16777619u;
+    }
+    return hash;
+}
+
+// Function to resolve a variable name to its index, allocating one on first use
+int resolveVariable(Program *program, const char *name) {
+    // Open addressing with linear probing, the table is never more than half full
+    unsigned int bucket = hashName(name) % VARIABLE_BUCKETS;
+    while (program->variable_buckets[bucket] != 0) {
+        int index = program->variable_buckets[bucket] - 1;
+        if (strcmp(program->variable_names[index], name) == 0) {
+            return index;
+        }
+        bucket = (bucket + 1) % VARIABLE_BUCKETS;
+    }
+    if (program->variable_count == MAX_VARIABLES_PER_PROCESS) {
+        printf("Error: More than %d variables used, '%s' cannot be stored\n", MAX_VARIABLES_PER_PROCESS, name);
+        return -1;
+    }
+    int index = program->variable_count++;
+    snprintf(program->variable_names[index], MAX_LINE_LENGTH, "%s", name);
+    program->variable_buckets[bucket] = (unsigned short)(index + 1);
+    return index;
+}
+
+// Function to intern a semaphore name to its ID, creating a binary semaphore on first use
+int resolveSemaphore(const char *name) {
+    for (int i = 0; i < semaphoreCount; i++) {
+        if (strcmp(semaphores[i].name, name) == 0) {
+            return i;
+        }
+    }
+    // Semaphores are only created while loading programs, before any thread uses the table
+    semaphores = (Semaphore *)realloc(semaphores, (semaphoreCount + 1) * sizeof(Semaphore));
+    if (semaphores == NULL) {
+        perror("Error growing semaphore table");
+        exit(EXIT_FAILURE);
+    }
+    Semaphore *semaphore = &semaphores[semaphoreCount];
+    snprintf(semaphore->name, sizeof(semaphore->name), "%s", name);
+    semaphore->value = 1;
+    semaphore->declared = false;
+    for (int level = 0; level < MLFQ_LEVELS; level++) {
+        initQueue(&semaphore->waiters[level]);
+    }
+    initQueue(&semaphore->holders);
+    semaphore->waiterCount = 0;
+    pthread_mutex_init(&semaphore->lock, NULL);
+    return semaphoreCount++;
+}
+
+// Function to get the index of a semaphore among the ones a program uses, adding it on first use
+int resolveProgramSemaphore(Program *program, const char *name) {
+    for (int i = 0; i < program->semaphore_count; i++) {
+        if (strcmp(program->semaphores[i].name, name) == 0) {
+            return i;
+        }
+    }
+    ProgramSemaphore *semaphores = (ProgramSemaphore *)realloc(program->semaphores, (program->semaphore_count + 1) * sizeof(ProgramSemaphore));
+    if (semaphores == NULL) {
+        perror("Error growing program semaphores");
+        exit(EXIT_FAILURE);
+    }
+    program->semaphores = semaphores;
+    ProgramSemaphore *semaphore = &semaphores[program->semaphore_count];
+    snprintf(semaphore->name, sizeof(semaphore->name), "%s", name);
+    semaphore->initial_value = -1;
+    semaphore->id = -1;
+    return program->semaphore_count++;
+}
+
+// Function to handle a "semaphore <name> <initial_value>" declaration of a program, it takes effect when a run uses the program
+bool declareSemaphore(Program *program, const char *line) {
+    char name[MAX_LINE_LENGTH];
+    int value;
+    if (sscanf(line, "semaphore %99s %d", name, &value) != 2 || value < 0) {
+        printf("Malformed semaphore declaration: %s\n", line);
+        return false;
+    }
+    int index = resolveProgramSemaphore(program, name); // May move the semaphores of the program
+    ProgramSemaphore *semaphore = &program->semaphores[index];
+    if (semaphore->initial_value >= 0 && semaphore->initial_value != value) {
+        printf("Warning: Semaphore %s is already declared with initial value %d\n", name, semaphore->initial_value);
+        return true;
+    }
+    semaphore->initial_value = value;
+    return true;
+}
+
+// Function to bind the semaphores of a program to the semaphore table of the run, applying its declarations if asked
+void bindSemaphores(Program *program, bool declare) {
+    for (int i = 0; i < program->semaphore_count; i++) {
+        ProgramSemaphore *used = &program->semaphores[i];
+        used->id = resolveSemaphore(used->name);
+        Semaphore *semaphore = &semaphores[used->id];
+        if (!declare || used->initial_value < 0) {
+            continue;
+        }
+        if (semaphore->declared && semaphore->value != used->initial_value) {
+            printf("Warning: Semaphore %s is already declared with initial value %d\n", used->name, semaphore->value);
+            continue;
+        }
+        semaphore->value = used->initial_value;
+        semaphore->declared = true;
+    }
+}
+
+// Function to decode an instruction line, returns false if the line is malformed
+bool decodeInstruction(Program *program, const char *line, Instruction *instruction) {
+    char buffer[MAX_LINE_LENGTH];
+    strcpy(buffer, line);
+
+    // Tokenize the instruction line
+    char *name = strtok(buffer, " ");
+    char *arg1 = strtok(NULL, " ");
+    char *arg2 = strtok(NULL, " ");
+    char *arg3 = strtok(NULL, "");
+
+    instruction->operand1 = 0;
+    instruction->operand2 = 0;
+    if (name == NULL || arg1 == NULL) {
+        printf("Malformed instruction: %s\n", line);
+        return false;
+    }
+
+    if (strcmp(name, "print") == 0) {
+        instruction->opcode = OP_PRINT;
+        instruction->operand1 = resolveVariable(program, arg1);
+    } else if (strcmp(name, "assign") == 0 && arg2 != NULL) {
+        instruction->operand1 = resolveVariable(program, arg1);
+        if (strcmp(arg2, "input") == 0 && arg3 == NULL) {
+            instruction->opcode = OP_ASSIGN_INPUT;
+        } else if (strcmp(arg2, "readFile") == 0 && arg3 != NULL) {
+            instruction->opcode = OP_ASSIGN_READFILE;
+            instruction->operand2 = resolveVariable(program, arg3);
+        } else {
+            // The literal is the rest of the line after the variable name
+            instruction->opcode = OP_ASSIGN;
+            instruction->operand2 = arg2 - buffer;
+        }
+    } else if (strcmp(name, "writeFile") == 0 && arg2 != NULL) {
+        instruction->opcode = OP_WRITE_FILE;
+        instruction->operand1 = resolveVariable(program, arg1);
+        instruction->operand2 = resolveVariable(program, arg2);
+    } else if (strcmp(name, "readFile") == 0) {
+        instruction->opcode = OP_READ_FILE;
+        instruction->operand1 = resolveVariable(program, arg1);
+    } else if (strcmp(name, "printFromTo") == 0 && arg2 != NULL) {
+        instruction->opcode = OP_PRINT_FROM_TO;
+        instruction->operand1 = resolveVariable(program, arg1);
+        instruction->operand2 = resolveVariable(program, arg2);
+    } else if (strcmp(name, "semWait") == 0) {
+        instruction->opcode = OP_SEM_WAIT;
+        instruction->operand1 = resolveProgramSemaphore(program, arg1);
+    } else if (strcmp(name, "semSignal") == 0) {
+        instruction->opcode = OP_SEM_SIGNAL;
+        instruction->operand1 = resolveProgramSemaphore(program, arg1);
+    } else {
+        printf("Unknown instruction: %s\n", line);
+        return false;
+    }
+    return instruction->operand1 >= 0 && instruction->operand2 >= 0;
+}
+
+// Function to parse and decode the instructions of a program file, returns NULL if it cannot be loaded
+Program* decodeProgram(const char *filename) {
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        perror("Error opening file");
+        printf("Error opening file: %s\n", filename); // Enhanced error message
+        return NULL;
+    }
+    Program *program = (Program *)calloc(1, sizeof(Program));
+    if (program == NULL) {
+        perror("Error allocating program");
+        exit(EXIT_FAILURE);
+    }
+
+    MemoryWord code[MAX_INSTRUCTIONS];
+    char line[MAX_LINE_LENGTH];
+    int instruction_index = 0;
+    while (fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0') {
+            continue; // Skip blank lines
+        }
+        if (strncmp(line, "semaphore ", 10) == 0) {
+            // Declarations do not occupy memory
+            if (!declareSemaphore(program, line)) {
+                fclose(file);
+                free(program->semaphores);
+                free(program);
+                return NULL;
+            }
+            continue;
+        }
+        if (instruction_index >= MAX_INSTRUCTIONS) {
+            printf("Error: Program %s has more than %d instructions\n", filename, MAX_INSTRUCTIONS);
+            fclose(file);
+            free(program->semaphores);
+            free(program);
+            return NULL;
+        }
+        MemoryWord *word = &code[instruction_index];
+        word->type = WORD_INSTRUCTION;
+        PROFILE_START(timer);
+        bool decoded = decodeInstruction(program, line, &word->instruction.decoded);
+        PROFILE_STOP(timer, PROFILE_DECODE);
+        if (!decoded) {
+            fclose(file);
+            free(program->semaphores);
+            free(program);
+            return NULL;
+        }
+        strcpy(word->instruction.text, line);
+        instruction_index++;
+    }
+    fclose(file);
+    if (PCB_WORDS + program->variable_count + instruction_index > MEMORY_SIZE) {
+        printf("Error: Program %s needs more than %d words of memory\n", filename, MEMORY_SIZE);
+        free(program->semaphores);
+        free(program);
+        return NULL;
+    }
+
+    // Keep only the decoded program, it is copied into memory once and shared while any process using it is resident
+    program->file = strdup(filename);
+    program->instruction_count = instruction_index;
+    program->code = (MemoryWord *)malloc(instruction_index * sizeof(MemoryWord));
+    memcpy(program->code, code, instruction_index * sizeof(MemoryWord));
+    program->code_base = -1;
+    return program;
+}
+
+// Function to get a program file, decoding it the first time it is used
+Program* loadProgram(const char *filename) {
+    for (int i = 0; i < programCount; i++) {
+        if (strcmp(programs[i]->file, filename) == 0) {
+            return programs[i];
+        }
+    }
+    Program *program = decodeProgram(filename);
+    if (program == NULL) {
+        return NULL;
+    }
+    programs = (Program **)realloc(programs, (programCount + 1) * sizeof(Program *));
+    if (programs == NULL) {
+        perror("Error growing program cache");
+        exit(EXIT_FAILURE);
+    }
+    programs[programCount++] = program;
+    return program;
+}
+
+void printQueue(const char *queueName, ProcessQueue *queue) {
+    fprintf(outputFile, "%s Queue:\n", queueName);
+    fprintf(outputFile, "+------------+-----------------------+\n");
+    fprintf(outputFile, "| Process ID | Current Instruction   |\n");
+    fprintf(outputFile, "+------------+-----------------------+\n");
+    for (int i = queue->front, count = 0; count < queue->size; i = (i + 1) % queue->capacity, count++) {
+        fprintf(outputFile, "| %-10d | %-21s |\n", queue->processes[i]->pcb.process_id, currentInstruction(queue->processes[i]));
+    }
+    fprintf(outputFile, "+------------+-----------------------+\n");
+}
+
+// Function to print the processes blocked on each semaphore and device, in wake-up order
+void printBlockedQueue() {
+    fprintf(outputFile, "Blocked Queue:\n");
+    fprintf(outputFile, "+------------+-----------------------+--------------+\n");
+    fprintf(outputFile, "| Process ID | Current Instruction   | Semaphore    |\n");
+    fprintf(outputFile, "+------------+-----------------------+--------------+\n");
+    for (int s = 0; s < semaphoreCount; s++) {
+        for (int level = 0; level < MLFQ_LEVELS; level++) {
+            ProcessQueue *queue = &semaphores[s].waiters[level];
+            for (int i = queue->front, count = 0; count < queue->size; i = (i + 1) % queue->capacity, count++) {
+                fprintf(outputFile, "| %-10d | %-21s | %-12s |\n", queue->processes[i]->pcb.process_id,
+                       currentInstruction(queue->processes[i]), semaphores[s].name);
+            }
+        }
+    }
+    for (int d = 0; d < DEVICE_COUNT; d++) {
+        ProcessQueue *queue = &devices[d].pending;
+        for (int i = queue->front, count = 0; count < queue->size; i = (i + 1) % queue->capacity, count++) {
+            fprintf(outputFile, "| %-10d | %-21s | %-12s |\n", queue->processes[i]->pcb.process_id,
+                   currentInstruction(queue->processes[i]), devices[d].name);
+        }
+    }
+    fprintf(outputFile, "+------------+-----------------------+--------------+\n");
+}
+
+void printStorageUnit(StorageUnit *unit) {
+    fprintf(outputFile, "Memory Contents:\n");
+    fprintf(outputFile, "+---------+------------+-----------------------+\n");
+    fprintf(outputFile, "| Address | Process ID | Contents              |\n");
+    fprintf(outputFile, "+---------+------------+-----------------------+\n");
+    for (Process *p = unit->head; p != NULL; p = p->storage_next) {
+        if (p->swapped) {
+            continue; // Only resident processes occupy memory
+        }
+        for (int j = 0; j < dataSize(p->program); j++) {
+            MemoryWord *word = processWord(p, j);
+            char contents[MAX_LINE_LENGTH + 8];
+            if (word->type == WORD_PCB) {
+                snprintf(contents, sizeof(contents), "%s=%d", pcb_field_names[j], word->field);
+            } else if (word->type == WORD_VARIABLE) {
+                snprintf(contents, sizeof(contents), "%.*s=%s", 20, p->program->variable_names[j - VARIABLES_OFFSET], word->variable.text);
+            } else {
+                continue;
+            }
+            fprintf(outputFile, "| %-7d | %-10d | %-21s |\n", p->pcb.memory_lower_bound + j, p->pcb.process_id, contents);
+        }
+    }
+    // Code segments are shared, so they are listed once rather than under each process
+    for (int i = 0; i < programCount; i++) {
+        Program *program = programs[i];
+        if (program->code_base < 0) {
+            continue;
+        }
+        for (int j = 0; j < program->instruction_count; j++) {
+            fprintf(outputFile, "| %-7d | %-10s | %-21s |\n", program->code_base + j, "code", memory[program->code_base + j].instruction.text);
+        }
+    }
+    fprintf(outputFile, "+---------+------------+-----------------------+\n");
+}
+
+void printReadyQueue(Core *core) {
+    char name[48];
+    if (scheduler->add != addToPriorityLevel) {
+        if (coreCount == 1) {
+            printQueue("Ready", &core->readyQueue.levels[0]);
+        } else {
+            snprintf(name, sizeof(name), "Ready (core %d)", core->id);
+            printQueue(name, &core->readyQueue.levels[0]);
+        }
+        return;
+    }
+    for (int level = 0; level < MLFQ_LEVELS; level++) {
+        if (coreCount == 1) {
+            snprintf(name, sizeof(name), "Ready (level %d)", level);
+        } else {
+            snprintf(name, sizeof(name), "Ready (core %d, level %d)", core->id, level);
+        }
+        printQueue(name, &core->readyQueue.levels[level]);
+    }
+}
+
+void printReadyQueues() {
+    for (int i = 0; i < coreCount; i++) {
+        printReadyQueue(&cores[i]);
+    }
+}
+
+// Function to write the program of a process to the event log, so its instructions can be rendered
+void traceProgram(Process *process) {
+    if (outputLevel != OUTPUT_EVENTS) {
+        return;
+    }
+    char *escaped = jsonEscape(process->program->file);
+    fprintf(outputFile, "{\"type\":\"program\",\"pid\":%d,\"arrival\":%d,\"file\":\"%s\",\"instructions\":[",
+            process->pcb.process_id, process->arrival_time, escaped);
+    free(escaped);
+    for (int i = 0; i < process->program->instruction_count; i++) {
+        escaped = jsonEscape(process->program->code[i].instruction.text);
+        fprintf(outputFile, "%s\"%s\"", i > 0 ? "," : "", escaped);
+        free(escaped);
+    }
+    fprintf(outputFile, "]}\n");
+}
+
+// Function to write a process of a queue as a [pid, pc] pair, a PC of -1 means it is swapped out
+void traceQueueEntry(Process *process) {
+    fprintf(outputFile, "%d,%d", process->pcb.process_id, process->swapped ? -1 : process->pcb.program_counter);
+}
+
+// Function to write the ready queues, blocked processes and memory map to the event log
+void traceState() {
+    bool first = true;
+    fprintf(outputFile, "{\"type\":\"state\",\"cycle\":%d,\"ready\":[", clockCycles);
+    for (int c = 0; c < coreCount; c++) {
+        for (int level = 0; level < MLFQ_LEVELS; level++) {
+            ProcessQueue *queue = &cores[c].readyQueue.levels[level];
+            for (int i = queue->front, count = 0; count < queue->size; i = (i + 1) % queue->capacity, count++) {
+                fprintf(outputFile, "%s[%d,%d,", first ? "" : ",", c, level);
+                traceQueueEntry(queue->processes[i]);
+                fprintf(outputFile, "]");
+                first = false;
+            }
+        }
+    }
+    fprintf(outputFile, "],\"blocked\":[");
+    first = true;
+    for (int s = 0; s < semaphoreCount; s++) {
+        for (int level = 0; level < MLFQ_LEVELS; level++) {
+            ProcessQueue *queue = &semaphores[s].waiters[level];
+            for (int i = queue->front, count = 0; count < queue->size; i = (i + 1) % queue->capacity, count++) {
+                fprintf(outputFile, "%s[", first ? "" : ",");
+                traceQueueEntry(queue->processes[i]);
+                fprintf(outputFile, ",%d]", s);
+                first = false;
+            }
+        }
+    }
+    for (int d = 0; d < DEVICE_COUNT; d++) {
+        ProcessQueue *queue = &devices[d].pending;
+        for (int i = queue->front, count = 0; count < queue->size; i = (i + 1) % queue->capacity, count++) {
+            fprintf(outputFile, "%s[", first ? "" : ",");
+            traceQueueEntry(queue->processes[i]);
+            fprintf(outputFile, ",%d]", -1 - d); // Devices have negative IDs
+            first = false;
+        }
+    }
+    fprintf(outputFile, "],\"memory\":[");
+    first = true;
+    for (Process *p = storageUnit.head; p != NULL; p = p->storage_next) {
+        if (p->swapped) {
+            continue;
+        }
+        fprintf(outputFile, "%s[%d,%d,%d]", first ? "" : ",", p->pcb.process_id, p->pcb.memory_lower_bound, p->pcb.memory_upper_bound);
+        first = false;
+    }
+    fprintf(outputFile, "]}\n");
+}
+
+void enqueueProcessToReadyQueue(Process *process) {
+    process->core = leastLoadedCore();
+    makeReady(process);
+    traceEvent("{\"type\":\"arrive\",\"cycle\":%d,\"pid\":%d}\n", clockCycles, process->pcb.process_id);
+    if (outputLevel != OUTPUT_TABLES) {
+        return;
+    }
+    fprintf(outputFile, "Process %d has arrived at clock cycle %d\n", process->pcb.process_id, clockCycles);
+    fprintf(outputFile, "Ready Queue:\n");
+    fprintf(outputFile, "+------------+-----------------------+\n");
+    fprintf(outputFile, "| Process ID | Current Instruction   |\n");
+    fprintf(outputFile, "+------------+-----------------------+\n");
+    fprintf(outputFile, "| %-10d | %-21s |\n", process->pcb.process_id, currentInstruction(process));
+    fprintf(outputFile, "+------------+-----------------------+\n");
+}
+
+// Function to admit an arriving process, it waits in the memory queue if there is not enough free memory
+void admitProcess(Process *process) {
+    if (!isQueueEmpty(&memoryQueue) || !loadProcess(process)) {
+        if (outputLevel == OUTPUT_TABLES) {
+            fprintf(outputFile, "Process %d has arrived at clock cycle %d and is waiting for memory\n", process->pcb.process_id, clockCycles);
+        }
+        traceEvent("{\"type\":\"wait_memory\",\"cycle\":%d,\"pid\":%d}\n", clockCycles, process->pcb.process_id);
+        enqueue(&memoryQueue, process);
+        return;
+    }
+    storeProcess(&storageUnit, process); // Add arriving process to the storage unit
+    enqueueProcessToReadyQueue(process);
+}
+
+// Function to admit waiting processes in arrival order once memory has been freed
+void admitWaitingProcesses() {
+    while (!isQueueEmpty(&memoryQueue) && loadProcess(memoryQueue.processes[memoryQueue.front])) {
+        Process *process = dequeue(&memoryQueue);
+        storeProcess(&storageUnit, process);
+        enqueueProcessToReadyQueue(process);
+    }
+}
+
+// Types of pending events
+typedef enum {
+    EVENT_ARRIVAL,
+    EVENT_IO_COMPLETE
+} EventType;
+
+// Structure to represent an event due at a clock cycle
+typedef struct {
+    int time;
+    long sequence; // Order the event was scheduled in, breaks ties between events due at the same cycle
+    EventType type;
+    Process *process;
+} Event;
+
+// Min-heap of pending events ordered by time
+typedef struct {
+    Event *events;
+    int capacity;
+    int size;
+    long next_sequence;
+} EventQueue;
+
+EventQueue eventQueue;
+
+// Function to initialize the event queue
+void initEventQueue(EventQueue *queue) {
+    queue->events = NULL;
+    queue->capacity = 0;
+    queue->size = 0;
+    queue->next_sequence = 0;
+}
+
+// Function to release the storage of the event queue
+void freeEventQueue(EventQueue *queue) {
+    free(queue->events);
+    initEventQueue(queue);
+}
+
+// Function to check if an event is due before another
+bool isEventBefore(Event *a, Event *b) {
+    return a->time < b->time || (a->time == b->time && a->sequence < b->sequence);
+}
+
+// Function to schedule an event
+void scheduleEvent(EventQueue *queue, int time, EventType type, Process *process) {
+    if (queue->size == queue->capacity) {
+        queue->capacity = queue->capacity == 0 ? 8 : queue->capacity * 2;
+        queue->events = (Event *)realloc(queue->events, queue->capacity * sizeof(Event));
+        if (queue->events == NULL) {
+            perror("Error growing event queue");
+            exit(EXIT_FAILURE);
+        }
+    }
+    Event event = {time, queue->next_sequence++, type, process};
+
+    // Sift the new event up from the bottom of the heap
+    int i = queue->size++;
+    while (i > 0 && isEventBefore(&event, &queue->events[(i - 1) / 2])) {
+        queue->events[i] = queue->events[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    queue->events[i] = event;
+}
+
+// Function to remove the earliest event
+Event popEvent(EventQueue *queue) {
+    Event earliest = queue->events[0];
+    Event last = queue->events[--queue->size];
+
+    // Sift the last event down from the top of the heap
+    int i = 0;
+    while (2 * i + 1 < queue->size) {
+        int child = 2 * i + 1;
+        if (child + 1 < queue->size && isEventBefore(&queue->events[child + 1], &queue->events[child])) {
+            child++;
+        }
+        if (!isEventBefore(&queue->events[child], &last)) {
+            break;
+        }
+        queue->events[i] = queue->events[child];
+        i = child;
+    }
+    queue->events[i] = last;
+    return earliest;
+}
+
+// Function to keep the statistics of a process that finished or is left at exit
+void recordMetrics(Process *process) {
+    if (metricsCount == metricsCapacity) {
+        metricsCapacity = metricsCapacity == 0 ? 16 : 2 * metricsCapacity;
+        metricsRecords = (ProcessMetrics *)realloc(metricsRecords, metricsCapacity * sizeof(ProcessMetrics));
+        if (metricsRecords == NULL) {
+            perror("Error growing statistics");
+            exit(EXIT_FAILURE);
+        }
+    }
+    ProcessMetrics *record = &metricsRecords[metricsCount++];
+    *record = process->metrics;
+    record->process_id = process->pcb.process_id;
+    record->arrival_time = process->arrival_time;
+    record->program_file = process->program->file;
+    process->metrics.blocked_cycles = NULL; // Owned by the record now
+}
+
+// Function to free a process and what it owns outside the memory
+void freeProcess(Process *process) {
+    if (process->input_file != NULL) {
+        fclose(process->input_file);
+    }
+    free(process->metrics.blocked_cycles); // NULL once its metrics were recorded
+    free(process);
+}
+
+// Function to remove a process from the simulation and reclaim its memory
+void discardProcess(Process *process) {
+    recordMetrics(process);
+    // Units the process never signalled stay taken, only its edges of the wait-for graph go
+    for (int i = 0; i < semaphoreCount; i++) {
+        while (removeHolder(&semaphores[i], process)) {
+        }
+    }
+    // Remove the process from the storage unit and reclaim its memory
+    removeStoredProcess(&storageUnit, process);
+    if (!process->swapped) {
+        freeMemory(process); // A process finishing its last I/O request may have been swapped out meanwhile
+    }
+    freeProcess(process);
+
+    // Reclaimed memory may let waiting processes in
+    admitWaitingProcesses();
+}
+
+// Function to remove a finished process from the simulation
+void retireProcess(Process *process) {
+    if (outputLevel == OUTPUT_TABLES) {
+        fprintf(outputFile, "Process %d has finished execution.\n", process->pcb.process_id);
+    }
+    traceEvent("{\"type\":\"finish\",\"cycle\":%d,\"pid\":%d}\n", clockCycles, process->pcb.process_id);
+    process->metrics.finish_time = clockCycles;
+    discardProcess(process);
+}
+
+// Function to let the device service the request of a process, scheduling its completion
+void serviceIo(Process *process) {
+    IoDevice *device = &devices[process->io_device];
+    int start = device->busy_until > clockCycles ? device->busy_until : clockCycles;
+    device->busy_until = start + device->latency;
+    device->requests++;
+    device->busy_cycles += device->latency;
+    scheduleEvent(&eventQueue, device->busy_until, EVENT_IO_COMPLETE, process);
+    if (outputLevel == OUTPUT_TABLES) {
+        fprintf(outputFile, "Process %d is waiting for the %s until clock cycle %d\n", process->pcb.process_id, device->name, device->busy_until);
+    }
+    traceEvent("{\"type\":\"io_start\",\"cycle\":%d,\"pid\":%d,\"device\":\"%s\",\"until\":%d}\n",
+               clockCycles, process->pcb.process_id, device->name, device->busy_until);
+}
+
+// Function to queue the I/O request of a process that blocked on its device, a console read is serviced once its line is typed
+void startIo(Process *process) {
+    enqueue(&devices[process->io_device].pending, process);
+    if (process->pending_input == -1) {
+        serviceIo(process);
+        return;
+    }
+    if (outputLevel == OUTPUT_TABLES) {
+        fprintf(outputFile, "Process %d is waiting for input on the console\n", process->pcb.process_id);
+    }
+    traceEvent("{\"type\":\"input_wait\",\"cycle\":%d,\"pid\":%d}\n", clockCycles, process->pcb.process_id);
+}
+
+// Function to give the lines typed on the console to the processes waiting for them, in request order
+void deliverConsoleInput(void) {
+    if (consoleReaders == 0) {
+        return;
+    }
+    pthread_mutex_lock(&outputLock);
+    pollConsole(false);
+    ProcessQueue *queue = &devices[DEVICE_CONSOLE].pending;
+    for (int i = queue->front, count = 0; count < queue->size && (consoleClosed || hasConsoleLine(MAX_LINE_LENGTH));
+         i = (i + 1) % queue->capacity, count++) {
+        Process *process = queue->processes[i];
+        if (process->pending_input == -1) {
+            continue; // Already has its line, the console is still servicing it
+        }
+        char value[MAX_LINE_LENGTH] = "";
+        takeConsoleLine(value, sizeof(value)); // Left empty once stdin has ended
+        if (inputLog != NULL) {
+            fprintf(inputLog, "%d\t%s\n", process->pcb.process_id, value);
+        }
+        storeVariables(process, process->pending_input, value);
+        process->pending_input = -1;
+        consoleReaders--;
+        serviceIo(process);
+    }
+    pthread_mutex_unlock(&outputLock);
+}
+
+// Function to unblock the process whose I/O request has completed
+void completeIo(Process *process) {
+    IoDevice *device = &devices[process->io_device];
+    dequeue(&device->pending); // Requests complete in issue order
+    process->metrics.io_cycles += clockCycles - process->metrics.blocked_since;
+    process->io_device = -1;
+    traceEvent("{\"type\":\"io_done\",\"cycle\":%d,\"pid\":%d}\n", clockCycles, process->pcb.process_id);
+    if (process->pcb.program_counter >= process->program->instruction_count) {
+        process->pcb.process_state = FINISHED; // The request was its last instruction
+        retireProcess(process);
+    } else {
+        makeReady(process);
+    }
+}
+
+// Function to handle every event due at or before the current clock cycle
+void dispatchEvents(EventQueue *queue) {
+    while (queue->size > 0 && queue->events[0].time <= clockCycles) {
+        Event event = popEvent(queue);
+        switch (event.type) {
+        case EVENT_ARRIVAL:
+            admitProcess(event.process);
+            break;
+        case EVENT_IO_COMPLETE:
+            completeIo(event.process);
+            break;
+        }
+    }
+}
+
+// Deadlock and priority inversion detection on the wait-for graph. A process blocked on a semaphore waits for
+// the processes holding its units, so a new edge only appears when a process blocks, and that is when it is checked.
+// The checks run in the retire phase, after every core has executed, so they see a consistent graph.
+
+// Function to take a blocked process out of the wait queue of its semaphore
+void cancelWait(Process *process) {
+    Semaphore *semaphore = &semaphores[process->pcb.waiting_for_resource];
+    for (int level = 0; level < MLFQ_LEVELS; level++) {
+        int position = queuePosition(&semaphore->waiters[level], process);
+        if (position >= 0) {
+            removeFromQueue(&semaphore->waiters[level], position);
+            semaphore->waiterCount--;
+            break;
+        }
+    }
+    addBlockedCycles(process);
+    process->pcb.waiting_for_resource = -1;
+}
+
+// Function to release every semaphore unit a process holds, handing them to waiters first
+void releaseSemaphores(Process *process) {
+    for (int i = 0; i < semaphoreCount; i++) {
+        while (removeHolder(&semaphores[i], process)) {
+            if (semaphores[i].waiterCount > 0) {
+                unblockProcess(&semaphores[i]);
+            } else {
+                semaphores[i].value++;
+            }
+        }
+    }
+}
+
+// Function to move a ready process to the ready queue level matching its MLFQ level
+void requeueReadyProcess(Process *process, int old_level) {
+    RunQueue *queue = &cores[process->core].readyQueue;
+    int position = queuePosition(&queue->levels[old_level], process);
+    if (position >= 0) {
+        removeFromQueue(&queue->levels[old_level], position);
+        scheduler->add(queue, process);
+    }
+}
+
+// Function to raise the MLFQ level of a semaphore holder to the level of a process waiting for it
+void inheritPriority(Process *holder, int level, Process *waiter) {
+    if (holder->priority_level <= level) {
+        return;
+    }
+    if (holder->base_priority_level == -1) {
+        holder->base_priority_level = holder->priority_level;
+    }
+    int old_level = holder->priority_level;
+    holder->priority_level = level;
+    if (outputLevel == OUTPUT_TABLES) {
+        fprintf(outputFile, "Process %d inherits priority level %d from Process %d\n", holder->pcb.process_id, level, waiter->pcb.process_id);
+    }
+    traceEvent("{\"type\":\"inherit\",\"cycle\":%d,\"pid\":%d,\"level\":%d,\"from\":%d}\n",
+               clockCycles, holder->pcb.process_id, level, waiter->pcb.process_id);
+    if (holder->pcb.process_state == READY) {
+        requeueReadyProcess(holder, old_level);
+    } else if (holder->pcb.process_state == BLOCKED && holder->pcb.waiting_for_resource != -1) {
+        // Passed on along the chain, the level only ever rises so the recursion ends even on a cycle
+        ProcessQueue *holders = &semaphores[holder->pcb.waiting_for_resource].holders;
+        for (int i = 0; i < holders->size; i++) {
+            inheritPriority(holders->processes[(holders->front + i) % holders->capacity], level, holder);
+        }
+    }
+}
+
+// Function to drop an inherited MLFQ level once the process no longer holds units higher priority processes wait for
+void restorePriority(Process *process) {
+    int level = process->base_priority_level;
+    for (int i = 0; i < semaphoreCount; i++) {
+        if (queuePosition(&semaphores[i].holders, process) < 0) {
+            continue;
+        }
+        for (int l = 0; l < MLFQ_LEVELS; l++) {
+            ProcessQueue *waiters = &semaphores[i].waiters[l];
+            for (int j = 0; j < waiters->size; j++) {
+                Process *waiter = waiters->processes[(waiters->front + j) % waiters->capacity];
+                if (waiter->priority_level < level) {
+                    level = waiter->priority_level;
+                }
+            }
+        }
+    }
+    if (level < process->base_priority_level) {
+        process->priority_level = level;
+        return;
+    }
+    process->priority_level = process->base_priority_level;
+    process->base_priority_level = -1;
+    if (outputLevel == OUTPUT_TABLES) {
+        fprintf(outputFile, "Process %d returns to priority level %d\n", process->pcb.process_id, process->priority_level);
+    }
+    traceEvent("{\"type\":\"inherit\",\"cycle\":%d,\"pid\":%d,\"level\":%d,\"from\":0}\n",
+               clockCycles, process->pcb.process_id, process->priority_level);
+}
+
+// Function to report the holders of a semaphore a process just blocked on that have a lower MLFQ priority
+void checkPriorityInversion(Process *process) {
+    Semaphore *semaphore = &semaphores[process->pcb.waiting_for_resource];
+    for (int i = 0; i < semaphore->holders.size; i++) {
+        Process *holder = semaphore->holders.processes[(semaphore->holders.front + i) % semaphore->holders.capacity];
+        if (holder->priority_level <= process->priority_level) {
+            continue;
+        }
+        priorityInversions++;
+        if (outputLevel == OUTPUT_TABLES) {
+            fprintf(outputFile, "Priority inversion: Process %d at level %d waits for semaphore %s held by Process %d at level %d\n",
+                   process->pcb.process_id, process->priority_level, semaphore->name, holder->pcb.process_id, holder->priority_level);
+        }
+        traceEvent("{\"type\":\"priority_inversion\",\"cycle\":%d,\"pid\":%d,\"level\":%d,\"semaphore\":%d,\"holder\":%d,\"holder_level\":%d}\n",
+                   clockCycles, process->pcb.process_id, process->priority_level, process->pcb.waiting_for_resource,
+                   holder->pcb.process_id, holder->priority_level);
+        if (priorityInheritance) {
+            inheritPriority(holder, process->priority_level, process);
+        }
+    }
+}
+
+// Function to collect the processes reachable from a blocked process in the wait-for graph, visiting each once,
+// returns true if all of them are blocked on semaphores held by processes among them, so none of them can run again;
+// closed is set if the graph leads back to the first process
+bool collectWaitFor(Process *process, ProcessQueue *members, bool *closed) {
+    int check = ++waitForChecks;
+    process->wait_for_check = check;
+    enqueue(members, process);
+    for (int i = 0; i < members->size; i++) {
+        Process *member = members->processes[(members->front + i) % members->capacity];
+        if (member->pcb.process_state != BLOCKED || member->pcb.waiting_for_resource == -1) {
+            return false;
+        }
+        // Units are assumed to be released by the processes holding them, a semaphore nobody holds may be signalled by anyone
+        ProcessQueue *holders = &semaphores[member->pcb.waiting_for_resource].holders;
+        if (isQueueEmpty(holders)) {
+            return false;
+        }
+        for (int j = 0; j < holders->size; j++) {
+            Process *holder = holders->processes[(holders->front + j) % holders->capacity];
+            *closed = *closed || holder == process;
+            if (holder->wait_for_check != check) {
+                holder->wait_for_check = check;
+                enqueue(members, holder);
+            }
+        }
+    }
+    return true;
+}
+
+// Function to report a deadlock and apply the deadlock policy to its victim
+void resolveDeadlock(ProcessQueue *members) {
+    // The victim is the process with the lowest priority, the one that arrived last among equals
+    Process *victim = NULL;
+    for (int i = 0; i < members->size; i++) {
+        Process *p = members->processes[(members->front + i) % members->capacity];
+        if (victim == NULL || p->priority_level > victim->priority_level
+            || (p->priority_level == victim->priority_level && p->arrival_time > victim->arrival_time)
+            || (p->priority_level == victim->priority_level && p->arrival_time == victim->arrival_time
+                && p->pcb.process_id > victim->pcb.process_id)) {
+            victim = p;
+        }
+    }
+    deadlockCount++;
+    for (int i = 0; i < members->size; i++) {
+        members->processes[(members->front + i) % members->capacity]->in_deadlock = true;
+    }
+
+    if (outputLevel == OUTPUT_TABLES) {
+        fprintf(outputFile, "Deadlock detected at clock cycle %d:\n", clockCycles);
+    }
+    if (outputLevel == OUTPUT_EVENTS) {
+        fprintf(outputFile, "{\"type\":\"deadlock\",\"cycle\":%d,\"action\":\"%s\",\"victim\":%d,\"waits\":[",
+                clockCycles, deadlock_policy_names[deadlockPolicy], victim->pcb.process_id);
+    }
+    bool first = true;
+    for (int i = 0; i < members->size; i++) {
+        Process *p = members->processes[(members->front + i) % members->capacity];
+        Semaphore *semaphore = &semaphores[p->pcb.waiting_for_resource];
+        for (int j = 0; j < semaphore->holders.size; j++) {
+            Process *holder = semaphore->holders.processes[(semaphore->holders.front + j) % semaphore->holders.capacity];
+            if (outputLevel == OUTPUT_TABLES) {
+                fprintf(outputFile, "  Process %d waits for semaphore %s held by Process %d\n", p->pcb.process_id, semaphore->name, holder->pcb.process_id);
+            } else if (outputLevel == OUTPUT_EVENTS) {
+                fprintf(outputFile, "%s[%d,%d,%d]", first ? "" : ",", p->pcb.process_id, p->pcb.waiting_for_resource, holder->pcb.process_id);
+                first = false;
+            }
+        }
+    }
+    if (outputLevel == OUTPUT_EVENTS) {
+        fprintf(outputFile, "]}\n");
+    }
+
+    switch (deadlockPolicy) {
+    case DEADLOCK_REPORT:
+        break;
+    case DEADLOCK_ABORT:
+        if (outputLevel == OUTPUT_TABLES) {
+            fprintf(outputFile, "Process %d is aborted to break the deadlock\n", victim->pcb.process_id);
+        }
+        cancelWait(victim);
+        releaseSemaphores(victim);
+        wakeProcesses(); // The waiters handed its units stop counting as blocked before the next check
+        discardProcess(victim); // Recorded as not finished
+        break;
+    case DEADLOCK_PREEMPT:
+        if (outputLevel == OUTPUT_TABLES) {
+            fprintf(outputFile, "Process %d is restarted from its first instruction to break the deadlock\n", victim->pcb.process_id);
+        }
+        cancelWait(victim);
+        releaseSemaphores(victim);
+        wakeProcesses(); // The waiters handed its units stop counting as blocked before the next check
+        victim->in_deadlock = false;
+        if (victim->base_priority_level != -1) {
+            victim->priority_level = victim->base_priority_level;
+            victim->base_priority_level = -1;
+        }
+        // The process gives up its memory and arrives again, so it starts over with fresh variables
+        removeStoredProcess(&storageUnit, victim);
+        if (!victim->swapped) {
+            freeMemory(victim);
+        }
+        victim->swapped = false;
+        victim->pcb.program_counter = 0;
+        victim->pcb.process_state = READY;
+        scheduleEvent(&eventQueue, clockCycles, EVENT_ARRIVAL, victim);
+        admitWaitingProcesses();
+        break;
+    case DEADLOCK_STOP:
+        if (outputLevel == OUTPUT_TABLES) {
+            fprintf(outputFile, "Stopping the simulation because of the deadlock\n");
+        }
+        deadlockStopped = true;
+        break;
+    }
+}
+
+// Function to check the wait-for graph after a process blocked on a semaphore
+void checkWaitForGraph(Process *process) {
+    checkPriorityInversion(process);
+    if (process->in_deadlock) {
+        return; // Closed the cycle of a deadlock reported for another process that blocked in the same cycle
+    }
+
+    // Every process reachable from the new edge is blocked forever if none of them can run,
+    // a process that only waits for an existing deadlock is blocked forever too, but did not cause a new one
+    ProcessQueue members;
+    initQueue(&members);
+    bool closed = false;
+    if (collectWaitFor(process, &members, &closed) && closed) {
+        resolveDeadlock(&members);
+    }
+    freeQueue(&members);
+}
+
+// Worker threads executing the cores in parallel
+pthread_barrier_t cycleStart;
+pthread_barrier_t cycleEnd;
+bool workersStopping = false;
+
+// Function to check if an instruction touches state shared between cores
+bool isSharedInstruction(Instruction *instruction) {
+    switch (instruction->opcode) {
+    case OP_PRINT:
+    case OP_ASSIGN:
+    case OP_PRINT_FROM_TO:
+        return false; // Only read and write the process's own memory
+    default:
+        return true;
+    }
+}
+
+// Function to execute one instruction of the process running on a core
+void executeOnCore(Core *core) {
+    Process *process = core->runningProcess;
+    process->last_used = clockCycles;
+    executeProcess(process);
+    core->busyCycles++;
+}
+
+// Function to execute the cores assigned to a host thread, cores are dealt out round-robin
+void executeCores(int thread) {
+    for (int i = thread; i < coreCount; i += threadCount) {
+        Core *core = &cores[i];
+        core->deferred = false;
+        if (core->runningProcess == NULL) {
+            continue;
+        }
+        Process *process = core->runningProcess;
+        if (deterministic && threadCount > 1 && isSharedInstruction(&instructionWord(process, process->pcb.program_counter)->instruction.decoded)) {
+            core->deferred = true;
+            continue;
+        }
+        executeOnCore(core);
+    }
+}
+
+void* runWorker(void *arg) {
+    int thread = (int)(intptr_t)arg;
+    while (true) {
+        pthread_barrier_wait(&cycleStart);
+        if (workersStopping) {
+            return NULL;
+        }
+        executeCores(thread);
+        pthread_barrier_wait(&cycleEnd);
+    }
+}
+
+// Function to execute one instruction on every core that has a running process
+void executeCycle() {
+    if (threadCount == 1) {
+        executeCores(0);
+        return;
+    }
+    pthread_barrier_wait(&cycleStart);
+    executeCores(0);
+    pthread_barrier_wait(&cycleEnd);
+
+    // Instructions touching shared state run in core order, so the result matches a single thread
+    for (int i = 0; i < coreCount; i++) {
+        if (cores[i].deferred) {
+            executeOnCore(&cores[i]);
+        }
+    }
+    for (int i = 0; i < coreCount; i++) {
+        flushCoreOutput(&cores[i]);
+    }
+}
+
+// Function to compare integers for qsort
+int compareInts(const void *a, const void *b) {
+    return (*(const int *)a > *(const int *)b) - (*(const int *)a < *(const int *)b);
+}
+
+// Structure to represent the distribution of a statistic over the finished processes
+typedef struct {
+    const char *name;
+    double mean;
+    int p50;
+    int p90;
+    int p99;
+    int max;
+} Distribution;
+
+// Function to get the nearest-rank percentile of sorted values
+int percentile(int *sorted, int count, int percent) {
+    int rank = (percent * count + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+// Statistics summarized over the finished processes
+typedef enum {
+    STAT_TURNAROUND,
+    STAT_WAITING,
+    STAT_RESPONSE
+} Statistic;
+
+// Function to summarize one statistic of the finished processes
+Distribution distribution(const char *name, Statistic statistic) {
+    Distribution result = {name, 0, 0, 0, 0, 0};
+    int *values = (int *)malloc((metricsCount + 1) * sizeof(int));
+    if (values == NULL) {
+        perror("Error allocating statistics");
+        exit(EXIT_FAILURE);
+    }
+    int count = 0;
+    long total = 0;
+    for (int i = 0; i < metricsCount; i++) {
+        ProcessMetrics *record = &metricsRecords[i];
+        if (record->finish_time == -1) {
+            continue;
+        }
+        int value = statistic == STAT_TURNAROUND ? record->finish_time - record->arrival_time
+                  : statistic == STAT_WAITING ? record->waiting_cycles
+                  : record->first_run - record->arrival_time;
+        values[count++] = value;
+        total += value;
+    }
+    if (count > 0) {
+        qsort(values, count, sizeof(int), compareInts);
+        result.mean = (double)total / count;
+        result.p50 = percentile(values, count, 50);
+        result.p90 = percentile(values, count, 90);
+        result.p99 = percentile(values, count, 99);
+        result.max = values[count - 1];
+    }
+    free(values);
+    return result;
+}
+
+// Function to get the cycles a recorded process spent blocked on a semaphore
+int blockedCycles(ProcessMetrics *record, int semaphore_id) {
+    return record->blocked_cycles == NULL ? 0 : record->blocked_cycles[semaphore_id];
+}
+
+// Function to write the statistics of every process and the run as CSV, or as JSON if the path ends in .json
+void writeMetrics(const char *path) {
+    FILE *file = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (file == NULL) {
+        perror("Error opening metrics file");
+        return;
+    }
+    size_t length = strlen(path);
+    bool json = length >= 5 && strcmp(path + length - 5, ".json") == 0;
+
+    int finished = 0;
+    long dispatches = 0;
+    long ioErrors = 0;
+    long busyCycles = 0;
+    for (int i = 0; i < metricsCount; i++) {
+        finished += metricsRecords[i].finish_time != -1;
+        dispatches += metricsRecords[i].dispatches;
+        ioErrors += metricsRecords[i].io_errors;
+    }
+    for (int i = 0; i < coreCount; i++) {
+        busyCycles += cores[i].busyCycles;
+    }
+    double throughput = clockCycles > 0 ? (double)finished / clockCycles : 0;
+    double utilization = clockCycles > 0 ? (double)busyCycles / ((long)clockCycles * coreCount) : 0;
+    Distribution distributions[] = {
+        distribution("turnaround", STAT_TURNAROUND),
+        distribution("waiting", STAT_WAITING),
+        distribution("response", STAT_RESPONSE)
+    };
+    int distributionCount = sizeof(distributions) / sizeof(distributions[0]);
+
+    if (json) {
+        fprintf(file, "{\n  \"processes\": [\n");
+    } else {
+        fprintf(file, "process_id,program,arrival,first_run,finish,turnaround,waiting,response,cpu,dispatches,io_errors,io_wait");
+        for (int s = 0; s < semaphoreCount; s++) {
+            fprintf(file, ",blocked_%s", semaphores[s].name);
+        }
+        fprintf(file, "\n");
+    }
+    for (int i = 0; i < metricsCount; i++) {
+        ProcessMetrics *record = &metricsRecords[i];
+        bool done = record->finish_time != -1;
+        bool ran = record->first_run != -1;
+        char *program = jsonEscape(record->program_file);
+        if (json) {
+            fprintf(file, "    {\"process_id\": %d, \"program\": \"%s\", \"arrival\": %d, ", record->process_id, program, record->arrival_time);
+            fprintf(file, ran ? "\"first_run\": %d, " : "\"first_run\": null, ", record->first_run);
+            fprintf(file, done ? "\"finish\": %d, " : "\"finish\": null, ", record->finish_time);
+            fprintf(file, done ? "\"turnaround\": %d, " : "\"turnaround\": null, ", record->finish_time - record->arrival_time);
+            fprintf(file, "\"waiting\": %d, ", record->waiting_cycles);
+            fprintf(file, ran ? "\"response\": %d, " : "\"response\": null, ", record->first_run - record->arrival_time);
+            fprintf(file, "\"cpu\": %d, \"dispatches\": %d, \"io_errors\": %d, \"io_wait\": %d, \"blocked\": {",
+                    record->cpu_cycles, record->dispatches, record->io_errors, record->io_cycles);
+            for (int s = 0; s < semaphoreCount; s++) {
+                fprintf(file, "%s\"%s\": %d", s > 0 ? ", " : "", semaphores[s].name, blockedCycles(record, s));
+            }
+            fprintf(file, "}}%s\n", i + 1 < metricsCount ? "," : "");
+        } else {
+            fprintf(file, "%d,%s,%d,", record->process_id, record->program_file, record->arrival_time);
+            fprintf(file, ran ? "%d," : ",", record->first_run);
+            fprintf(file, done ? "%d," : ",", record->finish_time);
+            fprintf(file, done ? "%d," : ",", record->finish_time - record->arrival_time);
+            fprintf(file, "%d,", record->waiting_cycles);
+            fprintf(file, ran ? "%d," : ",", record->first_run - record->arrival_time);
+            fprintf(file, "%d,%d,%d,%d", record->cpu_cycles, record->dispatches, record->io_errors, record->io_cycles);
+            for (int s = 0; s < semaphoreCount; s++) {
+                fprintf(file, ",%d", blockedCycles(record, s));
+            }
+            fprintf(file, "\n");
+        }
+        free(program);
+    }
+
+    if (json) {
+        fprintf(file, "  ],\n  \"summary\": {\n");
+        fprintf(file, "    \"scheduler\": \"%s\", \"cores\": %d, \"cycles\": %d, \"processes\": %d, \"finished\": %d,\n",
+                scheduler->name, coreCount, clockCycles, metricsCount, finished);
+        fprintf(file, "    \"throughput\": %.6f, \"cpu_utilization\": %.6f, \"context_switches\": %ld,\n", throughput, utilization, dispatches);
+        fprintf(file, "    \"io_errors\": %ld, \"file_cache\": {\"hits\": %d, \"misses\": %d, \"writes\": %d, \"flushes\": %d},\n",
+                ioErrors, fileCacheHits, fileCacheMisses, fileWrites, fileFlushes);
+        for (int d = 0; d < distributionCount; d++) {
+            Distribution *dist = &distributions[d];
+            fprintf(file, "    \"%s\": {\"mean\": %.3f, \"p50\": %d, \"p90\": %d, \"p99\": %d, \"max\": %d},\n",
+                    dist->name, dist->mean, dist->p50, dist->p90, dist->p99, dist->max);
+        }
+        fprintf(file, "    \"blocked\": {");
+        for (int s = 0; s < semaphoreCount; s++) {
+            long total = 0;
+            for (int i = 0; i < metricsCount; i++) {
+                total += blockedCycles(&metricsRecords[i], s);
+            }
+            fprintf(file, "%s\"%s\": %ld", s > 0 ? ", " : "", semaphores[s].name, total);
+        }
+        fprintf(file, "}\n  }\n}\n");
+    } else {
+        fprintf(file, "\nmetric,value\n");
+        fprintf(file, "scheduler,%s\ncores,%d\ncycles,%d\nprocesses,%d\nfinished,%d\n", scheduler->name, coreCount, clockCycles, metricsCount, finished);
+        fprintf(file, "throughput,%.6f\ncpu_utilization,%.6f\ncontext_switches,%ld\n", throughput, utilization, dispatches);
+        fprintf(file, "io_errors,%ld\nfile_cache_hits,%d\nfile_cache_misses,%d\nfile_writes,%d\nfile_flushes,%d\n",
+                ioErrors, fileCacheHits, fileCacheMisses, fileWrites, fileFlushes);
+        for (int d = 0; d < distributionCount; d++) {
+            Distribution *dist = &distributions[d];
+            fprintf(file, "%s_mean,%.3f\n%s_p50,%d\n%s_p90,%d\n%s_p99,%d\n%s_max,%d\n", dist->name, dist->mean,
+                    dist->name, dist->p50, dist->name, dist->p90, dist->name, dist->p99, dist->name, dist->max);
+        }
+        for (int s = 0; s < semaphoreCount; s++) {
+            long total = 0;
+            for (int i = 0; i < metricsCount; i++) {
+                total += blockedCycles(&metricsRecords[i], s);
+            }
+            fprintf(file, "blocked_%s,%ld\n", semaphores[s].name, total);
+        }
+    }
+    if (file != stdout) {
+        fclose(file);
+    }
+}
+
+// Checkpoints of the complete simulator state, written at a clock cycle boundary
+#define CHECKPOINT_MAGIC "OSCKPT04"
+
+// Structure to represent a checkpoint file being written or read, errors are checked once at the end
+typedef struct {
+    FILE *file;
+    bool failed;
+} Checkpoint;
+
+const char *checkpointPath; // Where checkpoints are written, NULL if they are not wanted
+int nextCheckpoint = -1; // Clock cycle of the next checkpoint, -1 if only signals trigger one
+int checkpointInterval = 0; // Cycles between checkpoints, 0 for a single one
+volatile sig_atomic_t checkpointRequested = 0; // Set by SIGUSR1
+const char *restorePath; // Checkpoint the simulation resumes from, NULL to start from cycle 0
+
+// Function to request a checkpoint at the next clock cycle boundary
+void requestCheckpoint(int signal_number) {
+    (void)signal_number;
+    checkpointRequested = 1;
+}
+
+// Function to write raw bytes, a failed write is remembered and reported when the checkpoint is closed
+void putBytes(Checkpoint *checkpoint, const void *data, size_t size) {
+    if (!checkpoint->failed && size > 0 && fwrite(data, 1, size, checkpoint->file) != size) {
+        checkpoint->failed = true;
+    }
+}
+
+void putInt(Checkpoint *checkpoint, int value) {
+    putBytes(checkpoint, &value, sizeof(value));
+}
+
+void putLong(Checkpoint *checkpoint, long value) {
+    putBytes(checkpoint, &value, sizeof(value));
+}
+
+void putString(Checkpoint *checkpoint, const char *text) {
+    int length = (int)strlen(text);
+    putInt(checkpoint, length);
+    putBytes(checkpoint, text, length);
+}
+
+// Function to read raw bytes, leaving them zeroed once the checkpoint has failed
+void getBytes(Checkpoint *checkpoint, void *data, size_t size) {
+    if (checkpoint->failed || fread(data, 1, size, checkpoint->file) != size) {
+        checkpoint->failed = true;
+        memset(data, 0, size);
+    }
+}
+
+int getInt(Checkpoint *checkpoint) {
+    int value;
+    getBytes(checkpoint, &value, sizeof(value));
+    return value;
+}
+
+long getLong(Checkpoint *checkpoint) {
+    long value;
+    getBytes(checkpoint, &value, sizeof(value));
+    return value;
+}
+
+// Function to read an integer that has to lie within [min, max], failing the checkpoint otherwise
+int getRange(Checkpoint *checkpoint, int min, int max) {
+    int value = getInt(checkpoint);
+    if (value < min || value > max) {
+        checkpoint->failed = true;
+        return min;
+    }
+    return value;
+}
+
+// Function to read a string into a buffer of the given size
+void getString(Checkpoint *checkpoint, char *text, int size) {
+    int length = getRange(checkpoint, 0, size - 1);
+    getBytes(checkpoint, text, length);
+    text[checkpoint->failed ? 0 : length] = '\0';
+}
+
+// Function to read a string of any length, the result must be freed by the caller
+char *getAllocatedString(Checkpoint *checkpoint) {
+    int length = getRange(checkpoint, 0, INT_MAX - 1);
+    char *text = (char *)malloc(length + 1);
+    if (text == NULL) {
+        perror("Error reading checkpoint");
+        exit(EXIT_FAILURE);
+    }
+    getBytes(checkpoint, text, length);
+    text[checkpoint->failed ? 0 : length] = '\0';
+    return text;
+}
+
+// Function to write the IDs of the processes in a queue
+void putQueue(Checkpoint *checkpoint, ProcessQueue *queue) {
+    putInt(checkpoint, queue->size);
+    for (int i = queue->front, count = 0; count < queue->size; i = (i + 1) % queue->capacity, count++) {
+        putInt(checkpoint, queue->processes[i]->pcb.process_id);
+    }
+}
+
+// Function to get the index of a program in the program cache
+int programIndex(Program *program) {
+    for (int i = 0; i < programCount; i++) {
+        if (programs[i] == program) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Function to write the statistics of a process
+void putMetrics(Checkpoint *checkpoint, ProcessMetrics *metrics) {
+    int fields[] = {metrics->first_run, metrics->finish_time, metrics->waiting_cycles, metrics->cpu_cycles, metrics->dispatches,
+                    metrics->io_errors, metrics->blocked_since, metrics->io_cycles};
+    putBytes(checkpoint, fields, sizeof(fields));
+    putInt(checkpoint, metrics->blocked_cycles != NULL);
+    if (metrics->blocked_cycles != NULL) {
+        putBytes(checkpoint, metrics->blocked_cycles, semaphoreCount * sizeof(int));
+    }
+}
+
+// Function to read the statistics of a process
+void getMetrics(Checkpoint *checkpoint, ProcessMetrics *metrics) {
+    int fields[8];
+    getBytes(checkpoint, fields, sizeof(fields));
+    metrics->first_run = fields[0];
+    metrics->finish_time = fields[1];
+    metrics->waiting_cycles = fields[2];
+    metrics->cpu_cycles = fields[3];
+    metrics->dispatches = fields[4];
+    metrics->io_errors = fields[5];
+    metrics->blocked_since = fields[6];
+    metrics->io_cycles = fields[7];
+    metrics->blocked_cycles = NULL;
+    if (getInt(checkpoint)) {
+        metrics->blocked_cycles = (int *)calloc(semaphoreCount, sizeof(int));
+        if (metrics->blocked_cycles == NULL) {
+            perror("Error allocating process statistics");
+            exit(EXIT_FAILURE);
+        }
+        getBytes(checkpoint, metrics->blocked_cycles, semaphoreCount * sizeof(int));
+    }
+}
+
+// Function to write a process, with its memory or its swap record
+void putProcess(Checkpoint *checkpoint, Process *process) {
+    int fields[] = {process->pcb.process_id, process->pcb.process_state, process->pcb.program_counter,
+                    process->pcb.memory_lower_bound, process->pcb.memory_upper_bound, process->pcb.cycles_remaining,
+                    process->pcb.waiting_for_resource, process->arrival_time, programIndex(process->program),
+                    process->last_used, process->ready_since, process->priority_level, process->core,
+                    process->io_device, process->pending_input, process->base_priority_level, process->in_deadlock, process->swapped,
+                    (int)process->input_seed, process->input_position};
+    putBytes(checkpoint, fields, sizeof(fields));
+    putLong(checkpoint, process->input_file != NULL ? ftell(process->input_file) : -1);
+    putMetrics(checkpoint, &process->metrics);
+
+    if (process->swapped) {
+        unsigned char *record = (unsigned char *)malloc(process->swap_size);
+        if (record == NULL || fseek(swapFile, process->swap_offset, SEEK_SET) != 0
+            || fread(record, 1, process->swap_size, swapFile) != (size_t)process->swap_size) {
+            perror("Error reading swap file");
+            exit(EXIT_FAILURE);
+        }
+        putInt(checkpoint, process->swap_size);
+        putBytes(checkpoint, record, process->swap_size);
+        free(record);
+    } else if (process->pcb.memory_lower_bound >= 0) {
+        // The PCB words are written as they are, they can lag behind the PCB while a process runs
+        for (int i = 0; i < PCB_WORDS; i++) {
+            putInt(checkpoint, processWord(process, i)->field);
+        }
+        for (int i = 0; i < process->program->variable_count; i++) {
+            MemoryWord *word = processWord(process, VARIABLES_OFFSET + i);
+            putInt(checkpoint, word->variable.type);
+            putInt(checkpoint, word->variable.number);
+            putString(checkpoint, word->variable.text);
+        }
+    }
+}
+
+// Function to read a process written by putProcess, programs are looked up among the ones of the checkpoint
+Process* getProcess(Checkpoint *checkpoint, Program **restored, int restoredCount) {
+    Process *process = (Process *)calloc(1, sizeof(Process));
+    if (process == NULL) {
+        perror("Error allocating process");
+        exit(EXIT_FAILURE);
+    }
+    process->pcb.process_id = getRange(checkpoint, 1, next_process_id - 1);
+    process->pcb.process_state = getRange(checkpoint, READY, BLOCKED);
+    process->pcb.program_counter = getInt(checkpoint);
+    process->pcb.memory_lower_bound = getRange(checkpoint, -1, MEMORY_SIZE - 1);
+    process->pcb.memory_upper_bound = getRange(checkpoint, -1, MEMORY_SIZE - 1);
+    process->pcb.cycles_remaining = getInt(checkpoint);
+    process->pcb.waiting_for_resource = getRange(checkpoint, -1, semaphoreCount - 1);
+    process->arrival_time = getInt(checkpoint);
+    process->program = restored[getRange(checkpoint, 0, restoredCount - 1)];
+    if (process->program == NULL) {
+        checkpoint->failed = true;
+        return process;
+    }
+    process->last_used = getInt(checkpoint);
+    process->ready_since = getInt(checkpoint);
+    process->priority_level = getRange(checkpoint, 0, MLFQ_LEVELS - 1);
+    process->core = getRange(checkpoint, 0, coreCount - 1);
+    process->io_device = getRange(checkpoint, -1, DEVICE_COUNT - 1);
+    process->pending_input = getRange(checkpoint, -1, process->program->variable_count - 1);
+    process->base_priority_level = getRange(checkpoint, -1, MLFQ_LEVELS - 1);
+    process->in_deadlock = getInt(checkpoint) != 0;
+    process->swapped = getInt(checkpoint) != 0;
+    process->input_seed = (unsigned int)getInt(checkpoint);
+    process->input_position = getInt(checkpoint);
+    process->swap_offset = -1;
+    long input_offset = getLong(checkpoint);
+    getMetrics(checkpoint, &process->metrics);
+    if (process->pcb.program_counter < 0 || process->pcb.program_counter > process->program->instruction_count) {
+        checkpoint->failed = true;
+    }
+
+    if (input_offset >= 0 && inputProvider == &fileInput) {
+        char path[MAX_LINE_LENGTH + 16];
+        snprintf(path, sizeof(path), "%s/%d.txt", inputDirectory, process->pcb.process_id);
+        process->input_file = fopen(path, "r");
+        if (process->input_file != NULL) {
+            fseek(process->input_file, input_offset, SEEK_SET);
+        }
+    }
+
+    if (process->swapped) {
+        int size = getRange(checkpoint, 0, PCB_WORDS * sizeof(int) + MAX_VARIABLES_PER_PROCESS * (MAX_LINE_LENGTH + 2));
+        unsigned char record[PCB_WORDS * sizeof(int) + MAX_VARIABLES_PER_PROCESS * (MAX_LINE_LENGTH + 2)];
+        getBytes(checkpoint, record, size);
+        if (swapFile == NULL) {
+            swapFile = tmpfile();
+            if (swapFile == NULL) {
+                perror("Error creating swap file");
+                exit(EXIT_FAILURE);
+            }
+        }
+        if (fseek(swapFile, swapFileEnd, SEEK_SET) != 0 || fwrite(record, 1, size, swapFile) != (size_t)size) {
+            perror("Error writing swap file");
+            exit(EXIT_FAILURE);
+        }
+        process->swap_offset = swapFileEnd;
+        process->swap_capacity = size;
+        process->swap_size = size;
+        swapFileEnd += size;
+    } else if (process->pcb.memory_lower_bound >= 0) {
+        if (process->pcb.memory_upper_bound - process->pcb.memory_lower_bound + 1 != dataSize(process->program)) {
+            checkpoint->failed = true;
+            return process;
+        }
+        initProcessWords(process);
+        for (int i = 0; i < PCB_WORDS; i++) {
+            processWord(process, i)->field = getInt(checkpoint);
+        }
+        for (int i = 0; i < process->program->variable_count; i++) {
+            MemoryWord *word = processWord(process, VARIABLES_OFFSET + i);
+            word->variable.type = (ValueType)getRange(checkpoint, VALUE_UNSET, VALUE_STRING);
+            word->variable.number = getInt(checkpoint);
+            getString(checkpoint, word->variable.text, MAX_LINE_LENGTH);
+        }
+    }
+    return process;
+}
+
+// Function to write the complete simulator state, returns false if the checkpoint cannot be written
+bool writeCheckpoint(const char *path) {
+    // Written to a temporary file first, so a crash never leaves a truncated checkpoint behind
+    char *temporary = (char *)malloc(strlen(path) + 5);
+    if (temporary == NULL) {
+        perror("Error writing checkpoint");
+        return false;
+    }
+    sprintf(temporary, "%s.tmp", path);
+    Checkpoint checkpoint = {fopen(temporary, "wb"), false};
+    if (checkpoint.file == NULL) {
+        perror("Error opening checkpoint");
+        free(temporary);
+        return false;
+    }
+    Checkpoint *cp = &checkpoint;
+    putBytes(cp, CHECKPOINT_MAGIC, 8);
+    int layout[] = {MEMORY_SIZE, MAX_VARIABLES_PER_PROCESS, MAX_LINE_LENGTH, MLFQ_LEVELS, PCB_WORDS};
+    putBytes(cp, layout, sizeof(layout));
+    putInt(cp, clockCycles);
+    putInt(cp, next_process_id);
+    putInt(cp, coreCount);
+
+    // Semaphores come first, decoding the programs again has to resolve their names to the same IDs
+    putInt(cp, semaphoreCount);
+    for (int i = 0; i < semaphoreCount; i++) {
+        putString(cp, semaphores[i].name);
+        putInt(cp, semaphores[i].value);
+        putInt(cp, semaphores[i].declared);
+    }
+
+    // Programs keep their source text, the restore decodes it again
+    putInt(cp, programCount);
+    for (int i = 0; i < programCount; i++) {
+        Program *program = programs[i];
+        putString(cp, program->file);
+        putInt(cp, program->instruction_count);
+        for (int j = 0; j < program->instruction_count; j++) {
+            putString(cp, program->code[j].instruction.text);
+        }
+        putInt(cp, program->code_base);
+        putInt(cp, program->references);
+    }
+    putInt(cp, memoryHoleCount);
+    putBytes(cp, memoryHoles, memoryHoleCount * sizeof(MemoryHole));
+
+    // Every process that has not finished: stored, waiting for memory, or yet to arrive
+    int arrivals = 0;
+    for (int i = 0; i < eventQueue.size; i++) {
+        arrivals += eventQueue.events[i].type == EVENT_ARRIVAL;
+    }
+    putInt(cp, storageUnit.size + memoryQueue.size + arrivals);
+    for (Process *p = storageUnit.head; p != NULL; p = p->storage_next) {
+        putProcess(cp, p);
+    }
+    for (int i = memoryQueue.front, count = 0; count < memoryQueue.size; i = (i + 1) % memoryQueue.capacity, count++) {
+        putProcess(cp, memoryQueue.processes[i]);
+    }
+    for (int i = 0; i < eventQueue.size; i++) {
+        if (eventQueue.events[i].type == EVENT_ARRIVAL) {
+            putProcess(cp, eventQueue.events[i].process);
+        }
+    }
+    putInt(cp, storageUnit.size);
+    for (Process *p = storageUnit.head; p != NULL; p = p->storage_next) {
+        putInt(cp, p->pcb.process_id);
+    }
+    putQueue(cp, &memoryQueue);
+    putLong(cp, eventQueue.next_sequence);
+    putInt(cp, eventQueue.size);
+    for (int i = 0; i < eventQueue.size; i++) {
+        Event *event = &eventQueue.events[i];
+        putInt(cp, event->time);
+        putLong(cp, event->sequence);
+        putInt(cp, event->type);
+        putInt(cp, event->process->pcb.process_id);
+    }
+
+    for (int i = 0; i < coreCount; i++) {
+        putInt(cp, cores[i].runningProcess != NULL ? cores[i].runningProcess->pcb.process_id : 0);
+        putLong(cp, cores[i].busyCycles);
+        putInt(cp, cores[i].migrations);
+        for (int level = 0; level < MLFQ_LEVELS; level++) {
+            putQueue(cp, &cores[i].readyQueue.levels[level]);
+        }
+    }
+    for (int i = 0; i < semaphoreCount; i++) {
+        for (int level = 0; level < MLFQ_LEVELS; level++) {
+            putQueue(cp, &semaphores[i].waiters[level]);
+        }
+        putQueue(cp, &semaphores[i].holders);
+    }
+    for (int i = 0; i < DEVICE_COUNT; i++) {
+        putInt(cp, devices[i].busy_until);
+        putInt(cp, devices[i].requests);
+        putInt(cp, devices[i].busy_cycles);
+        putQueue(cp, &devices[i].pending);
+    }
+    int swapStats[] = {swapIns, swapOuts, deadlockCount, priorityInversions};
+    putBytes(cp, swapStats, sizeof(swapStats));
+    putLong(cp, swapBytesIn);
+    putLong(cp, swapBytesOut);
+
+    // Cached files, including writes that have not reached disk yet
+    int fileStats[] = {fileCacheHits, fileCacheMisses, fileWrites, fileFlushes, fileCacheCount};
+    putBytes(cp, fileStats, sizeof(fileStats));
+    for (int i = 0; i < fileCacheCount; i++) {
+        putString(cp, fileCache[i].path);
+        putString(cp, fileCache[i].data);
+        putInt(cp, fileCache[i].dirty);
+    }
+
+    putInt(cp, metricsCount);
+    for (int i = 0; i < metricsCount; i++) {
+        ProcessMetrics *record = &metricsRecords[i];
+        Program *program = NULL;
+        for (int j = 0; j < programCount && program == NULL; j++) {
+            program = programs[j]->file == record->program_file ? programs[j] : NULL;
+        }
+        putInt(cp, record->process_id);
+        putInt(cp, record->arrival_time);
+        putInt(cp, programIndex(program));
+        putMetrics(cp, record);
+    }
+    putBytes(cp, CHECKPOINT_MAGIC, 8);
+
+    bool failed = checkpoint.failed;
+    if (fclose(checkpoint.file) != 0 || failed || rename(temporary, path) != 0) {
+        perror("Error writing checkpoint");
+        remove(temporary);
+        free(temporary);
+        return false;
+    }
+    free(temporary);
+    if (outputLevel == OUTPUT_TABLES) {
+        fprintf(outputFile, "Checkpoint written to %s at clock cycle %d\n", path, clockCycles);
+    }
+    char *escaped = jsonEscape(path);
+    traceEvent("{\"type\":\"checkpoint\",\"cycle\":%d,\"path\":\"%s\"}\n", clockCycles, escaped);
+    free(escaped);
+    return true;
+}
+
+// Function to read the IDs of a queue of processes and enqueue them
+void getQueue(Checkpoint *checkpoint, ProcessQueue *queue, Process **byId) {
+    int size = getRange(checkpoint, 0, next_process_id);
+    for (int i = 0; i < size && !checkpoint->failed; i++) {
+        Process *process = byId[getRange(checkpoint, 1, next_process_id - 1)];
+        if (process == NULL) {
+            checkpoint->failed = true;
+            return;
+        }
+        enqueue(queue, process);
+    }
+}
+
+// Function to restore the simulator state from a checkpoint, after the cores and scheduler are set up
+bool restoreCheckpoint(const char *path) {
+    Checkpoint checkpoint = {fopen(path, "rb"), false};
+    if (checkpoint.file == NULL) {
+        perror("Error opening checkpoint");
+        return false;
+    }
+    Checkpoint *cp = &checkpoint;
+    char magic[8];
+    int layout[5];
+    getBytes(cp, magic, sizeof(magic));
+    getBytes(cp, layout, sizeof(layout));
+    int expected[] = {MEMORY_SIZE, MAX_VARIABLES_PER_PROCESS, MAX_LINE_LENGTH, MLFQ_LEVELS, PCB_WORDS};
+    if (cp->failed || memcmp(magic, CHECKPOINT_MAGIC, 8) != 0 || memcmp(layout, expected, sizeof(layout)) != 0) {
+        printf("Error: %s is not a checkpoint of this build of the simulator\n", path);
+        fclose(checkpoint.file);
+        return false;
+    }
+    clockCycles = getRange(cp, 0, INT_MAX);
+    next_process_id = getRange(cp, 1, INT_MAX - 1);
+    int checkpointCores = getInt(cp);
+    if (!cp->failed && checkpointCores != coreCount) {
+        printf("Error: Checkpoint %s was taken with --cores %d\n", path, checkpointCores);
+        fclose(checkpoint.file);
+        return false;
+    }
+
+    int count = getRange(cp, 0, INT_MAX);
+    for (int i = 0; i < count && !cp->failed; i++) {
+        char name[MAX_LINE_LENGTH];
+        getString(cp, name, sizeof(name));
+        if (resolveSemaphore(name) != i) {
+            printf("Error: Semaphore %s of checkpoint %s has a different ID in this run\n", name, path);
+            cp->failed = true;
+            break;
+        }
+        semaphores[i].value = getInt(cp);
+        semaphores[i].declared = getInt(cp) != 0;
+    }
+
+    // The checkpoint's programs are added to the program cache, processes refer to them by their position in the checkpoint
+    int restoredCount = getRange(cp, 0, INT_MAX);
+    Program **restored = (Program **)calloc(restoredCount > 0 ? restoredCount : 1, sizeof(Program *));
+    if (restored == NULL) {
+        perror("Error restoring checkpoint");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < restoredCount && !cp->failed; i++) {
+        Program *program = (Program *)calloc(1, sizeof(Program));
+        if (program == NULL) {
+            perror("Error allocating program");
+            exit(EXIT_FAILURE);
+        }
+        program->file = getAllocatedString(cp);
+        program->instruction_count = getRange(cp, 0, MAX_INSTRUCTIONS);
+        program->code = (MemoryWord *)calloc(program->instruction_count > 0 ? program->instruction_count : 1, sizeof(MemoryWord));
+        if (program->code == NULL) {
+            perror("Error allocating program");
+            exit(EXIT_FAILURE);
+        }
+        for (int j = 0; j < program->instruction_count && !cp->failed; j++) {
+            MemoryWord *word = &program->code[j];
+            word->type = WORD_INSTRUCTION;
+            getString(cp, word->instruction.text, MAX_LINE_LENGTH);
+            if (!cp->failed && !decodeInstruction(program, word->instruction.text, &word->instruction.decoded)) {
+                cp->failed = true;
+            }
+        }
+        bindSemaphores(program, false); // Values come from the checkpoint
+        program->code_base = getRange(cp, -1, MEMORY_SIZE - program->instruction_count);
+        program->references = getRange(cp, 0, INT_MAX);
+        if (program->code_base >= 0) {
+            memcpy(&memory[program->code_base], program->code, program->instruction_count * sizeof(MemoryWord));
+        }
+        programs = (Program **)realloc(programs, (programCount + 1) * sizeof(Program *));
+        if (programs == NULL) {
+            perror("Error growing program cache");
+            exit(EXIT_FAILURE);
+        }
+        programs[programCount++] = program;
+        restored[i] = program;
+    }
+
+    memoryHoleCount = getRange(cp, 0, MEMORY_SIZE);
+    getBytes(cp, memoryHoles, memoryHoleCount * sizeof(MemoryHole));
+    for (int i = 0; i < memoryHoleCount; i++) {
+        if (memoryHoles[i].start < 0 || memoryHoles[i].size < 1 || memoryHoles[i].start + memoryHoles[i].size > MEMORY_SIZE) {
+            cp->failed = true;
+        }
+    }
+
+    Process **byId = (Process **)calloc(next_process_id, sizeof(Process *));
+    if (byId == NULL) {
+        perror("Error restoring checkpoint");
+        exit(EXIT_FAILURE);
+    }
+    count = getRange(cp, 0, next_process_id - 1);
+    for (int i = 0; i < count && !cp->failed; i++) {
+        Process *process = getProcess(cp, restored, restoredCount);
+        if (byId[process->pcb.process_id] != NULL) {
+            cp->failed = true;
+        }
+        byId[process->pcb.process_id] = process;
+    }
+
+    count = getRange(cp, 0, next_process_id - 1);
+    for (int i = 0; i < count && !cp->failed; i++) {
+        Process *process = byId[getRange(cp, 1, next_process_id - 1)];
+        if (process == NULL || findStoredProcess(&storageUnit, process->pcb.process_id) != NULL) {
+            cp->failed = true;
+            break;
+        }
+        storeProcess(&storageUnit, process);
+    }
+    getQueue(cp, &memoryQueue, byId);
+    long next_sequence = getLong(cp);
+    count = getRange(cp, 0, INT_MAX);
+    Event *events = (Event *)calloc(count > 0 ? count : 1, sizeof(Event));
+    if (events == NULL) {
+        perror("Error restoring checkpoint");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < count && !cp->failed; i++) {
+        events[i].time = getInt(cp);
+        events[i].sequence = getLong(cp);
+        events[i].type = (EventType)getRange(cp, EVENT_ARRIVAL, EVENT_IO_COMPLETE);
+        events[i].process = byId[getRange(cp, 1, next_process_id - 1)];
+        if (events[i].process == NULL) {
+            cp->failed = true;
+        }
+    }
+    // Scheduled again in their original order, so events due at the same cycle keep their order
+    for (int scheduled = 0; scheduled < count && !cp->failed; scheduled++) {
+        int earliest = -1;
+        for (int i = 0; i < count; i++) {
+            if (events[i].process != NULL && (earliest == -1 || events[i].sequence < events[earliest].sequence)) {
+                earliest = i;
+            }
+        }
+        scheduleEvent(&eventQueue, events[earliest].time, events[earliest].type, events[earliest].process);
+        events[earliest].process = NULL;
+    }
+    free(events);
+    eventQueue.next_sequence = next_sequence;
+
+    for (int i = 0; i < coreCount && !cp->failed; i++) {
+        int running = getRange(cp, 0, next_process_id - 1);
+        cores[i].runningProcess = running > 0 ? byId[running] : NULL;
+        cores[i].busyCycles = getLong(cp);
+        cores[i].migrations = getInt(cp);
+        // Ready processes are added through the scheduler, so a run can resume under another policy
+        ProcessQueue ready;
+        initQueue(&ready);
+        for (int level = 0; level < MLFQ_LEVELS; level++) {
+            getQueue(cp, &ready, byId);
+        }
+        while (!isQueueEmpty(&ready)) {
+            scheduler->add(&cores[i].readyQueue, dequeue(&ready));
+        }
+        freeQueue(&ready);
+    }
+    for (int i = 0; i < semaphoreCount && !cp->failed; i++) {
+        for (int level = 0; level < MLFQ_LEVELS; level++) {
+            getQueue(cp, &semaphores[i].waiters[level], byId);
+            semaphores[i].waiterCount += semaphores[i].waiters[level].size;
+        }
+        getQueue(cp, &semaphores[i].holders, byId);
+    }
+    for (int i = 0; i < DEVICE_COUNT && !cp->failed; i++) {
+        devices[i].busy_until = getInt(cp);
+        devices[i].requests = getInt(cp);
+        devices[i].busy_cycles = getInt(cp);
+        getQueue(cp, &devices[i].pending, byId);
+    }
+    ProcessQueue *console = &devices[DEVICE_CONSOLE].pending;
+    for (int i = console->front, count = 0; count < console->size && !cp->failed; i = (i + 1) % console->capacity, count++) {
+        consoleReaders += console->processes[i]->pending_input != -1;
+    }
+    swapIns = getInt(cp);
+    swapOuts = getInt(cp);
+    deadlockCount = getInt(cp);
+    priorityInversions = getInt(cp);
+    swapBytesIn = getLong(cp);
+    swapBytesOut = getLong(cp);
+
+    fileCacheHits = getInt(cp);
+    fileCacheMisses = getInt(cp);
+    fileWrites = getInt(cp);
+    fileFlushes = getInt(cp);
+    count = getRange(cp, 0, INT_MAX);
+    for (int i = 0; i < count && !cp->failed; i++) {
+        char *filePath = getAllocatedString(cp);
+        CachedFile *file = addCachedFile(filePath);
+        free(filePath);
+        free(file->data);
+        file->data = getAllocatedString(cp);
+        file->size = strlen(file->data);
+        file->dirty = getInt(cp) != 0;
+    }
+
+    count = getRange(cp, 0, INT_MAX);
+    for (int i = 0; i < count && !cp->failed; i++) {
+        Process finished = {0};
+        finished.pcb.process_id = getInt(cp);
+        finished.arrival_time = getInt(cp);
+        finished.program = restored[getRange(cp, 0, restoredCount - 1)];
+        if (finished.program == NULL) {
+            cp->failed = true;
+            break;
+        }
+        getMetrics(cp, &finished.metrics);
+        recordMetrics(&finished);
+    }
+    getBytes(cp, magic, sizeof(magic));
+    if (memcmp(magic, CHECKPOINT_MAGIC, 8) != 0) {
+        cp->failed = true;
+    }
+    fclose(checkpoint.file);
+    free(restored);
+    free(byId);
+    if (cp->failed) {
+        printf("Error: Checkpoint %s is corrupt\n", path);
+        return false;
+    }
+    if (outputLevel == OUTPUT_TABLES) {
+        fprintf(outputFile, "Restored checkpoint %s at clock cycle %d\n", path, clockCycles);
+    }
+    char *escaped = jsonEscape(path);
+    traceEvent("{\"type\":\"restore\",\"cycle\":%d,\"path\":\"%s\"}\n", clockCycles, escaped);
+    free(escaped);
+    return true;
+}
+
+// Function to report a process that had not finished when the run ended, state is NULL for a stored process
+void reportUnfinished(Process *process, const char *state, bool print) {
+    char description[2 * MAX_LINE_LENGTH];
+    if (state != NULL) {
+        snprintf(description, sizeof(description), "%s", state);
+    } else if (process->io_device != -1) {
+        snprintf(description, sizeof(description), "waiting for the %s", devices[process->io_device].name);
+    } else if (process->pcb.process_state == BLOCKED && process->pcb.waiting_for_resource != -1) {
+        snprintf(description, sizeof(description), "blocked on semaphore %s", semaphores[process->pcb.waiting_for_resource].name);
+    } else if (process->pcb.process_state == RUNNING) {
+        snprintf(description, sizeof(description), "running");
+    } else {
+        snprintf(description, sizeof(description), "ready");
+    }
+    if (print) {
+        fprintf(outputFile, "Process %d did not finish: %s\n", process->pcb.process_id, description);
+    } else if (outputLevel == OUTPUT_EVENTS) {
+        char *escaped = jsonEscape(description);
+        traceEvent("{\"type\":\"unfinished\",\"pid\":%d,\"state\":\"%s\"}\n", process->pcb.process_id, escaped);
+        free(escaped);
+    }
+}
+
+// Function to report every process left behind, printed in the summary or traced to the event log
+void reportUnfinishedProcesses(bool print) {
+    // A run stopped on a deadlock can leave ready and unarrived processes besides the blocked ones
+    for (Process *p = storageUnit.head; p != NULL; p = p->storage_next) {
+        reportUnfinished(p, NULL, print);
+    }
+    for (int i = memoryQueue.front, count = 0; count < memoryQueue.size; i = (i + 1) % memoryQueue.capacity, count++) {
+        reportUnfinished(memoryQueue.processes[i], "waiting for memory", print);
+    }
+    for (int i = 0; i < eventQueue.size; i++) {
+        if (eventQueue.events[i].type == EVENT_ARRIVAL) {
+            char state[48];
+            snprintf(state, sizeof(state), "arriving at clock cycle %d", eventQueue.events[i].time);
+            reportUnfinished(eventQueue.events[i].process, state, print);
+        }
+    }
+}
+
+// Structure to represent an option of a run, shared by the argument parser and the batch preloader
+typedef struct {
+    const char *name;
+    bool takes_value;
+    bool *flag; // Set by an option without a value
+} RunOption;
+
+RunOption runOptions[] = {
+    {"--scheduler", true, NULL}, {"--quantum", true, NULL}, {"--mlfq-quanta", true, NULL}, {"--aging", true, NULL},
+    {"--cores", true, NULL}, {"--threads", true, NULL}, {"--deterministic", false, &deterministic},
+    {"--swap-policy", true, NULL}, {"--semaphore-queue", true, NULL}, {"--output", true, NULL},
+    {"--trace-file", true, NULL}, {"--metrics", true, NULL}, {"--file-sync", true, NULL},
+    {"--disk-latency", true, NULL}, {"--console-latency", true, NULL}, {"--input", true, NULL},
+    {"--record-input", true, NULL}, {"--checkpoint", true, NULL}, {"--checkpoint-at", true, NULL},
+    {"--checkpoint-every", true, NULL}, {"--restore", true, NULL}, {"--deadlock", true, NULL},
+    {"--priority-inheritance", false, &priorityInheritance}
+};
+
+// Function to find an option of a run by name, returns NULL if the argument is not one
+RunOption* findRunOption(const char *argument) {
+    for (size_t i = 0; i < sizeof(runOptions) / sizeof(runOptions[0]); i++) {
+        if (strcmp(runOptions[i].name, argument) == 0) {
+            return &runOptions[i];
+        }
+    }
+    return NULL;
+}
+
+// Function to run one simulation with the given arguments, returns its exit status
+int runScenario(int argc, char *argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s [--scheduler fcfs|rr|sjf|hrrn|mlfq] [--quantum <cycles>] [--mlfq-quanta <q0,q1,...>] [--aging <cycles>]\n", argv[0]);
+        printf("          [--cores <count>] [--threads <count>] [--deterministic] [--swap-policy lru|largest]\n");
+        printf("          [--semaphore-queue fifo|priority] [--output tables|events|summary|silent] [--trace-file <path>]\n");
+        printf("          [--metrics <path>] [--file-sync exit|write] [--disk-latency <cycles>] [--console-latency <cycles>]\n");
+        printf("          [--input stdin|file:<directory>|random[:<seed>]|replay:<log>] [--record-input <log>]\n");
+        printf("          [--checkpoint <path>] [--checkpoint-at <cycle>] [--checkpoint-every <cycles>] [--restore <path>]\n");
+        printf("          [--deadlock report|abort|preempt|stop] [--priority-inheritance]\n");
+        printf("          <arrival_time1> <program_file1> [<arrival_time2> <program_file2> ...]\n");
+        printf("       %s --batch <manifest> [--jobs <count>] [--batch-output <directory>]\n", argv[0]);
+        return 1;
+    }
+
+    // The event log goes through one large buffer, which has to be set before anything is written
+    outputFile = stdout;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--output") == 0 && strcmp(argv[i + 1], "events") == 0) {
+            setvbuf(stdout, NULL, _IOFBF, TRACE_BUFFER_SIZE);
+        }
+    }
+
+    // Initialize the wake queue, semaphores, and storage unit
+    initQueue(&wakeQueue);
+    for (int i = 0; i < DEVICE_COUNT; i++) {
+        initQueue(&devices[i].pending);
+    }
+
+    // Semaphores every program can use without declaring them
+    resolveSemaphore("userInput");
+    resolveSemaphore("file");
+    resolveSemaphore("userOutput");
+    initStorageUnit(&storageUnit);
+    initQueue(&memoryQueue);
+    initEventQueue(&eventQueue);
+    initMemory();
+
+    // Parse the program files and arrival times
+    for (int i = 1; i < argc; i += 2) {
+        RunOption *option = findRunOption(argv[i]);
+        if (option != NULL && !option->takes_value) {
+            *option->flag = true;
+            i--; // Takes no value
+            continue;
+        }
+        if (option == NULL && strncmp(argv[i], "--", 2) == 0) {
+            printf("Error: Unknown option %s\n", argv[i]);
+            return 1;
+        }
+        if (i + 1 >= argc) {
+            printf(option != NULL ? "Error: Missing value for %s\n" : "Error: Missing program file for arrival time %s\n", argv[i]);
+            return 1;
+        }
+
+        if (strcmp(argv[i], "--swap-policy") == 0) {
+            if (strcmp(argv[i + 1], "lru") == 0) {
+                selectVictim = selectLruVictim;
+            } else if (strcmp(argv[i + 1], "largest") == 0) {
+                selectVictim = selectLargestVictim;
+            } else {
+                printf("Error: Unknown swap policy %s\n", argv[i + 1]);
+                return 1;
+            }
+            continue;
+        }
+        if (strcmp(argv[i], "--output") == 0) {
+            if (strcmp(argv[i + 1], "tables") == 0) {
+                outputLevel = OUTPUT_TABLES;
+            } else if (strcmp(argv[i + 1], "events") == 0) {
+                outputLevel = OUTPUT_EVENTS;
+            } else if (strcmp(argv[i + 1], "summary") == 0) {
+                outputLevel = OUTPUT_SUMMARY;
+            } else if (strcmp(argv[i + 1], "silent") == 0) {
+                outputLevel = OUTPUT_SILENT;
+            } else {
+                printf("Error: Unknown output level %s\n", argv[i + 1]);
+                return 1;
+            }
+            continue;
+        }
+        if (strcmp(argv[i], "--metrics") == 0) {
+            metricsPath = argv[i + 1];
+            continue;
+        }
+        if (strcmp(argv[i], "--disk-latency") == 0 || strcmp(argv[i], "--console-latency") == 0) {
+            int latency = atoi(argv[i + 1]);
+            if (latency < 0) {
+                printf("Error: I/O latency must not be negative\n");
+                return 1;
+            }
+            devices[strcmp(argv[i], "--disk-latency") == 0 ? DEVICE_DISK : DEVICE_CONSOLE].latency = latency;
+            continue;
+        }
+        if (strcmp(argv[i], "--input") == 0) {
+            if (strcmp(argv[i + 1], "stdin") == 0) {
+                inputProvider = &stdinInput;
+            } else if (strncmp(argv[i + 1], "file:", 5) == 0) {
+                inputProvider = &fileInput;
+                inputDirectory = argv[i + 1] + 5;
+            } else if (strcmp(argv[i + 1], "random") == 0 || strncmp(argv[i + 1], "random:", 7) == 0) {
+                inputProvider = &randomInput;
+                inputSeed = argv[i + 1][6] == ':' ? (unsigned int)strtoul(argv[i + 1] + 7, NULL, 10) : 1;
+            } else if (strncmp(argv[i + 1], "replay:", 7) == 0) {
+                inputProvider = &replayInput;
+                if (!loadReplayLog(argv[i + 1] + 7)) {
+                    return 1;
+                }
+            } else {
+                printf("Error: Unknown input source %s\n", argv[i + 1]);
+                return 1;
+            }
+            continue;
+        }
+        if (strcmp(argv[i], "--record-input") == 0) {
+            inputLog = fopen(argv[i + 1], "w");
+            if (inputLog == NULL) {
+                perror("Error opening input log");
+                return 1;
+            }
+            continue;
+        }
+        if (strcmp(argv[i], "--checkpoint") == 0) {
+            checkpointPath = argv[i + 1];
+            continue;
+        }
+        if (strcmp(argv[i], "--checkpoint-at") == 0 || strcmp(argv[i], "--checkpoint-every") == 0) {
+            int cycles = atoi(argv[i + 1]);
+            if (cycles < (strcmp(argv[i], "--checkpoint-at") == 0 ? 0 : 1)) {
+                printf("Error: Invalid checkpoint cycle %s\n", argv[i + 1]);
+                return 1;
+            }
+            if (strcmp(argv[i], "--checkpoint-at") == 0) {
+                nextCheckpoint = cycles;
+            } else {
+                checkpointInterval = cycles;
+            }
+            continue;
+        }
+        if (strcmp(argv[i], "--restore") == 0) {
+            restorePath = argv[i + 1];
+            continue;
+        }
+        if (strcmp(argv[i], "--file-sync") == 0) {
+            if (strcmp(argv[i + 1], "exit") == 0) {
+                syncPolicy = SYNC_AT_EXIT;
+            } else if (strcmp(argv[i + 1], "write") == 0) {
+                syncPolicy = SYNC_ON_WRITE;
+            } else {
+                printf("Error: Unknown file sync policy %s\n", argv[i + 1]);
+                return 1;
+            }
+            continue;
+        }
+        if (strcmp(argv[i], "--trace-file") == 0) {
+            outputFile = fopen(argv[i + 1], "w");
+            if (outputFile == NULL) {
+                perror("Error opening trace file");
+                return 1;
+            }
+            setvbuf(outputFile, NULL, _IOFBF, TRACE_BUFFER_SIZE);
+            continue;
+        }
+        if (strcmp(argv[i], "--deadlock") == 0) {
+            int policy = 0;
+            while (policy <= DEADLOCK_STOP && strcmp(argv[i + 1], deadlock_policy_names[policy]) != 0) {
+                policy++;
+            }
+            if (policy > DEADLOCK_STOP) {
+                printf("Error: Unknown deadlock policy %s\n", argv[i + 1]);
+                return 1;
+            }
+            deadlockPolicy = (DeadlockPolicy)policy;
+            continue;
+        }
+        if (strcmp(argv[i], "--semaphore-queue") == 0) {
+            if (strcmp(argv[i + 1], "fifo") == 0) {
+                priorityWaitQueues = false;
+            } else if (strcmp(argv[i + 1], "priority") == 0) {
+                priorityWaitQueues = true;
+            } else {
+                printf("Error: Unknown semaphore queue policy %s\n", argv[i + 1]);
+                return 1;
+            }
+            continue;
+        }
+        if (strcmp(argv[i], "--scheduler") == 0) {
+            scheduler = findScheduler(argv[i + 1]);
+            if (scheduler == NULL) {
+                printf("Error: Unknown scheduler %s\n", argv[i + 1]);
+                return 1;
+            }
+            continue;
+        }
+        if (strcmp(argv[i], "--quantum") == 0) {
+            timeQuantum = atoi(argv[i + 1]);
+            if (timeQuantum < 1) {
+                printf("Error: Quantum must be at least 1\n");
+                return 1;
+            }
+            continue;
+        }
+        if (strcmp(argv[i], "--mlfq-quanta") == 0) {
+            // Levels without a quantum of their own reuse the last one given
+            char *quantum = strtok(argv[i + 1], ",");
+            for (int level = 0; level < MLFQ_LEVELS; level++) {
+                if (quantum != NULL) {
+                    mlfqQuanta[level] = atoi(quantum);
+                    quantum = strtok(NULL, ",");
+                } else if (level > 0) {
+                    mlfqQuanta[level] = mlfqQuanta[level - 1];
+                }
+                if (mlfqQuanta[level] < 1) {
+                    printf("Error: Quantum must be at least 1\n");
+                    return 1;
+                }
+            }
+            continue;
+        }
+        if (strcmp(argv[i], "--cores") == 0) {
+            coreCount = atoi(argv[i + 1]);
+            if (coreCount < 1) {
+                printf("Error: At least one core is needed\n");
+                return 1;
+            }
+            continue;
+        }
+        if (strcmp(argv[i], "--threads") == 0) {
+            threadCount = atoi(argv[i + 1]);
+            if (threadCount < 1) {
+                printf("Error: At least one thread is needed\n");
+                return 1;
+            }
+            continue;
+        }
+        if (strcmp(argv[i], "--aging") == 0) {
+            // A threshold below 1 would promote every waiting process each cycle, undoing MLFQ demotion
+            char *end;
+            long threshold = strtol(argv[i + 1], &end, 10);
+            if (end == argv[i + 1] || *end != '\0' || threshold < 1 || threshold > INT_MAX) {
+                printf("Error: Aging threshold must be a number of cycles of at least 1\n");
+                return 1;
+            }
+            agingThreshold = (int)threshold;
+            continue;
+        }
+
+        int arrival_time = atoi(argv[i]);
+        char *filename = argv[i + 1];
+
+        Process *process = (Process *)calloc(1, sizeof(Process));
+        process->pcb.process_id = next_process_id++;
+        process->pcb.process_state = READY;
+        process->pcb.program_counter = 0;
+        process->pcb.cycles_remaining = -1;
+        process->pcb.waiting_for_resource = -1;
+        process->arrival_time = arrival_time;
+        process->pcb.memory_lower_bound = -1;
+        process->pcb.memory_upper_bound = -1;
+        process->swap_offset = -1;
+        process->io_device = -1;
+        process->pending_input = -1;
+        process->base_priority_level = -1;
+        process->metrics.first_run = -1;
+        process->metrics.finish_time = -1;
+        process->program = loadProgram(filename);
+        if (process->program == NULL) {
+            // If loading the program fails, free the allocated memory and break out of the loop
+            free(process);
+            printf("Failed to load program: %s\n", filename);
+            return 1;
+        }
+        bindSemaphores(process->program, true);
+
+        scheduleEvent(&eventQueue, arrival_time, EVENT_ARRIVAL, process);
+    }
+    if (checkpointPath == NULL && (nextCheckpoint >= 0 || checkpointInterval > 0)) {
+        printf("Error: Checkpoint cycles need --checkpoint <path>\n");
+        return 1;
+    }
+    if (restorePath != NULL && eventQueue.size > 0) {
+        // The checkpoint holds every process of the run, new arrivals could reuse its process IDs
+        printf("Error: Programs cannot be added to a restored run\n");
+        return 1;
+    }
+
+    cores = (Core *)calloc(coreCount, sizeof(Core));
+    if (cores == NULL) {
+        perror("Error allocating cores");
+        return 1;
+    }
+    for (int i = 0; i < coreCount; i++) {
+        cores[i].id = i;
+        initRunQueue(&cores[i].readyQueue);
+        pthread_mutex_init(&cores[i].readyLock, NULL);
+    }
+    if (restorePath != NULL && !restoreCheckpoint(restorePath)) {
+        return 1;
+    }
+    if (checkpointInterval > 0 && nextCheckpoint < 0) {
+        nextCheckpoint = clockCycles + checkpointInterval;
+    }
+    if (checkpointPath != NULL) {
+        signal(SIGUSR1, requestCheckpoint);
+    }
+
+    // Describe the run, so the event log can be rendered without the program files
+    traceEvent("{\"type\":\"run\",\"scheduler\":\"%s\",\"cores\":%d,\"levels\":%d}\n",
+               scheduler->name, coreCount, scheduler->add == addToPriorityLevel ? MLFQ_LEVELS : 1);
+    for (int i = 0; i < semaphoreCount; i++) {
+        traceEvent("{\"type\":\"semaphore\",\"id\":%d,\"name\":\"%s\",\"value\":%d}\n", i, semaphores[i].name, semaphores[i].value);
+    }
+    for (Process *p = storageUnit.head; p != NULL; p = p->storage_next) {
+        traceProgram(p); // Resident processes of a restored run
+    }
+    for (int i = memoryQueue.front, count = 0; count < memoryQueue.size; i = (i + 1) % memoryQueue.capacity, count++) {
+        traceProgram(memoryQueue.processes[i]);
+    }
+    for (int i = 0; i < eventQueue.size; i++) {
+        if (eventQueue.events[i].type == EVENT_ARRIVAL) {
+            traceProgram(eventQueue.events[i].process);
+        }
+    }
+
+    // Start the worker threads, the main thread executes its share of the cores too
+    if (threadCount > coreCount) {
+        threadCount = coreCount;
+    }
+    pthread_t *workers = (pthread_t *)calloc(threadCount, sizeof(pthread_t));
+    int *newlyBlocked = (int *)calloc(coreCount, sizeof(int)); // Processes that blocked on a semaphore this cycle
+    if (threadCount > 1) {
+        pthread_barrier_init(&cycleStart, NULL, threadCount);
+        pthread_barrier_init(&cycleEnd, NULL, threadCount);
+        for (int i = 1; i < threadCount; i++) {
+            if (pthread_create(&workers[i], NULL, runWorker, (void *)(intptr_t)i) != 0) {
+                perror("Error creating worker thread");
+                return 1;
+            }
+        }
+    }
+
+    // Execute processes from the ready queues, one instruction per core per clock cycle
+    while (true) {
+        // Checkpoints are taken between cycles, when no instruction is half executed
+        if (checkpointPath != NULL && (checkpointRequested || (nextCheckpoint >= 0 && clockCycles >= nextCheckpoint))) {
+            checkpointRequested = 0;
+            writeCheckpoint(checkpointPath);
+            while (nextCheckpoint >= 0 && clockCycles >= nextCheckpoint) {
+                nextCheckpoint = checkpointInterval > 0 ? nextCheckpoint + checkpointInterval : -1;
+            }
+        }
+
+        // Check for process arrivals, and lines typed for processes waiting on the console
+        PROFILE_START(eventsTimer);
+        deliverConsoleInput();
+        dispatchEvents(&eventQueue);
+        PROFILE_STOP(eventsTimer, PROFILE_PHASE_EVENTS);
+
+        bool allIdle = true;
+        for (int i = 0; i < coreCount; i++) {
+            allIdle = allIdle && isCoreIdle(&cores[i]);
+        }
+        if (allIdle) {
+            if (eventQueue.size == 0 && consoleReaders > 0) {
+                // Only the console can make a process ready, the clock stands still until a line is typed
+                fflush(outputFile);
+                pthread_mutex_lock(&outputLock);
+                pollConsole(true);
+                pthread_mutex_unlock(&outputLock);
+                continue;
+            }
+            if (eventQueue.size == 0) {
+                break; // Nothing can become ready any more
+            }
+            // All cores are idle, jump straight to the next event
+            if (outputLevel == OUTPUT_TABLES) {
+                fprintf(outputFile, "CPU idle from clock cycle %d to %d\n", clockCycles, eventQueue.events[0].time);
+            }
+            traceEvent("{\"type\":\"idle\",\"cycle\":%d,\"until\":%d}\n", clockCycles, eventQueue.events[0].time);
+            clockCycles = eventQueue.events[0].time;
+            continue;
+        }
+
+        // Give every core without a running process the next one from its ready queue, or steal one
+        PROFILE_START(dispatchTimer);
+        for (int i = 0; i < coreCount; i++) {
+            Core *core = &cores[i];
+            if (core->runningProcess != NULL) {
+                continue;
+            }
+            Process *next = isRunQueueEmpty(&core->readyQueue) ? stealProcess(core) : scheduler->pick(&core->readyQueue);
+            if (next == NULL) {
+                continue;
+            }
+            next->metrics.waiting_cycles += clockCycles - next->ready_since;
+            if (next->swapped && !swapIn(next)) {
+                makeReady(next); // Not enough memory even after swapping, retry next cycle
+                continue;
+            }
+            next->pcb.process_state = RUNNING;
+            next->pcb.cycles_remaining = scheduler->quantum(next);
+            syncPcb(next);
+            if (next->metrics.first_run == -1) {
+                next->metrics.first_run = clockCycles;
+            }
+            next->metrics.dispatches++;
+            core->runningProcess = next;
+        }
+
+        PROFILE_STOP(dispatchTimer, PROFILE_PHASE_DISPATCH);
 
-        // Print the status of all queues after processing
-        printQueue("Ready", &readyQueue);
-        printQueue("Blocked", &blockedQueue);
-        printStorageUnit(&storageQueue);
+        // Print the status of all queues before executing each instruction
+        PROFILE_START(outputTimer);
+        if (outputLevel == OUTPUT_TABLES) {
+            printReadyQueues();
+            printBlockedQueue();
+            printStorageUnit(&storageUnit);
+        } else if (outputLevel == OUTPUT_EVENTS) {
+            traceState();
+        }
+        PROFILE_STOP(outputTimer, PROFILE_PHASE_OUTPUT);
+
+        PROFILE_START(executeTimer);
+        executeCycle();
+        PROFILE_STOP(executeTimer, PROFILE_PHASE_EXECUTE);
+
+        PROFILE_START(retireTimer);
+        clockCycles++;
+        wakeProcesses(); // Unblocked processes are ready from the next cycle on
+
+        int blockedCount = 0;
+        for (int i = 0; i < coreCount; i++) {
+            Process *process = cores[i].runningProcess;
+            if (process == NULL) {
+                continue;
+            }
+            if (process->pcb.process_state == FINISHED) {
+                cores[i].runningProcess = NULL;
+                retireProcess(process);
+            } else if (process->pcb.process_state != RUNNING) {
+                // Blocked, or already unblocked again by a core that ran after it in this cycle
+                cores[i].runningProcess = NULL;
+                if (process->io_device != -1) {
+                    startIo(process); // Queued in core order, so the devices see the same order on any number of threads
+                } else if (process->pcb.process_state == BLOCKED && process->pcb.waiting_for_resource != -1) {
+                    newlyBlocked[blockedCount++] = process->pcb.process_id;
+                }
+            } else if (process->base_priority_level != -1) {
+                restorePriority(process); // It may have signalled the semaphore it inherited its level for
+            }
+        }
 
-        // Break the loop if no processes are active and no processes are in the blocked queue
-        if (!anyProcessActive && isQueueEmpty(&blockedQueue)) {
+        // Checked once every core is retired, a deadlock victim may have been running on a later core
+        for (int i = 0; i < blockedCount && !deadlockStopped; i++) {
+            Process *process = findStoredProcess(&storageUnit, newlyBlocked[i]);
+            if (process != NULL && process->pcb.process_state == BLOCKED && process->pcb.waiting_for_resource != -1) {
+                checkWaitForGraph(process);
+            }
+        }
+        if (deadlockStopped) {
+            PROFILE_STOP(retireTimer, PROFILE_PHASE_RETIRE);
             break;
         }
 
-        // Increment clock cycles for idle waiting
-        if (!anyProcessActive) {
-            clockCycles++;
+        // Check if new processes arrive during current execution
+        dispatchEvents(&eventQueue);
+
+        for (int i = 0; i < coreCount; i++) {
+            Process *process = cores[i].runningProcess;
+            if (process != NULL && process->pcb.cycles_remaining == 0) {
+                // Time quantum expired, move to the ready queue behind the arrivals
+                scheduler->expired(process);
+                makeReady(process);
+                cores[i].runningProcess = NULL;
+            }
+        }
+        PROFILE_STOP(retireTimer, PROFILE_PHASE_RETIRE);
+    }
+
+    if (threadCount > 1) {
+        workersStopping = true;
+        pthread_barrier_wait(&cycleStart);
+        for (int i = 1; i < threadCount; i++) {
+            pthread_join(workers[i], NULL);
+        }
+        pthread_barrier_destroy(&cycleStart);
+        pthread_barrier_destroy(&cycleEnd);
+    }
+    free(workers);
+    free(newlyBlocked);
+
+    // Print the status of all queues after processing
+    if (outputLevel == OUTPUT_TABLES) {
+        printReadyQueues();
+        printBlockedQueue();
+        printStorageUnit(&storageUnit);
+    } else if (outputLevel == OUTPUT_EVENTS) {
+        traceState();
+    }
+
+    int blocked = blockedProcessCount();
+    // Processes left the run by finishing or by being aborted to break a deadlock
+    int finished = 0;
+    int aborted = 0;
+    for (int i = 0; i < metricsCount; i++) {
+        if (metricsRecords[i].finish_time >= 0) {
+            finished++;
+        } else {
+            aborted++;
+        }
+    }
+    int unfinished = storageUnit.size + memoryQueue.size;
+    for (int i = 0; i < eventQueue.size; i++) {
+        unfinished += eventQueue.events[i].type == EVENT_ARRIVAL;
+    }
+    traceEvent("{\"type\":\"end\",\"cycle\":%d,\"blocked\":%d,\"finished\":%d,\"aborted\":%d}\n", clockCycles, blocked, finished, aborted);
+    reportUnfinishedProcesses(false);
+    for (int i = 0; i < coreCount; i++) {
+        traceEvent("{\"type\":\"core\",\"core\":%d,\"busy\":%d,\"migrations\":%d}\n", i, cores[i].busyCycles, cores[i].migrations);
+    }
+    flushFileCache();
+    traceEvent("{\"type\":\"file_stats\",\"hits\":%d,\"misses\":%d,\"writes\":%d,\"flushes\":%d}\n",
+               fileCacheHits, fileCacheMisses, fileWrites, fileFlushes);
+    for (int d = 0; d < DEVICE_COUNT; d++) {
+        traceEvent("{\"type\":\"io_stats\",\"device\":\"%s\",\"latency\":%d,\"requests\":%d,\"busy\":%d}\n",
+                   devices[d].name, devices[d].latency, devices[d].requests, devices[d].busy_cycles);
+    }
+    traceEvent("{\"type\":\"deadlock_stats\",\"deadlocks\":%d,\"inversions\":%d}\n", deadlockCount, priorityInversions);
+    traceEvent("{\"type\":\"swap_stats\",\"swap_ins\":%d,\"bytes_in\":%ld,\"swap_outs\":%d,\"bytes_out\":%ld}\n",
+               swapIns, swapBytesIn, swapOuts, swapBytesOut);
+    // The event log already holds the summary
+    bool printSummary = outputLevel == OUTPUT_TABLES || outputLevel == OUTPUT_SUMMARY;
+    if (printSummary && blocked > 0) {
+        fprintf(outputFile, "%d processes are blocked forever at clock cycle %d.\n", blocked, clockCycles);
+    }
+    if (printSummary && unfinished == 0 && aborted == 0) {
+        fprintf(outputFile, "All processes have finished execution.\n");
+    }
+    if (printSummary && aborted > 0) {
+        fprintf(outputFile, "%d processes finished, %d aborted by deadlock resolution.\n", finished, aborted);
+    }
+    if (printSummary) {
+        reportUnfinishedProcesses(true);
+    }
+    if (printSummary && coreCount > 1) {
+        fprintf(outputFile, "Core statistics:\n");
+        fprintf(outputFile, "+------+-------------+------------+\n");
+        fprintf(outputFile, "| Core | Utilization | Migrations |\n");
+        fprintf(outputFile, "+------+-------------+------------+\n");
+        for (int i = 0; i < coreCount; i++) {
+            double utilization = clockCycles > 0 ? 100.0 * cores[i].busyCycles / clockCycles : 0;
+            fprintf(outputFile, "| %-4d | %10.1f%% | %-10d |\n", i, utilization, cores[i].migrations);
+        }
+        fprintf(outputFile, "+------+-------------+------------+\n");
+    }
+    if (printSummary) {
+        fprintf(outputFile, "Swap statistics: %d swap-ins (%ld bytes), %d swap-outs (%ld bytes)\n", swapIns, swapBytesIn, swapOuts, swapBytesOut);
+    }
+    for (int d = 0; d < DEVICE_COUNT; d++) {
+        if (printSummary && devices[d].requests > 0) {
+            fprintf(outputFile, "I/O statistics: %s serviced %d requests, busy for %d cycles\n", devices[d].name, devices[d].requests, devices[d].busy_cycles);
+        }
+    }
+    if (printSummary && fileCacheHits + fileCacheMisses + fileWrites > 0) {
+        fprintf(outputFile, "File cache: %d hits, %d misses, %d writes, %d flushes\n", fileCacheHits, fileCacheMisses, fileWrites, fileFlushes);
+    }
+    if (printSummary && deadlockCount + priorityInversions > 0) {
+        fprintf(outputFile, "Deadlocks: %d detected, %d priority inversions\n", deadlockCount, priorityInversions);
+    }
+    if (metricsPath != NULL) {
+        // Blocked processes and processes still waiting for memory did not finish
+        for (Process *p = storageUnit.head; p != NULL; p = p->storage_next) {
+            if (p->pcb.process_state == BLOCKED) {
+                addBlockedCycles(p);
+            }
+            recordMetrics(p);
+        }
+        for (int i = memoryQueue.front, count = 0; count < memoryQueue.size; i = (i + 1) % memoryQueue.capacity, count++) {
+            recordMetrics(memoryQueue.processes[i]);
+        }
+        writeMetrics(metricsPath);
+    }
+#ifdef PROFILE
+    printProfile();
+#endif
+    for (int i = 0; i < metricsCount; i++) {
+        free(metricsRecords[i].blocked_cycles);
+    }
+    free(metricsRecords);
+    if (outputFile != stdout) {
+        fclose(outputFile);
+    }
+    if (swapFile != NULL) {
+        fclose(swapFile);
+    }
+    if (inputLog != NULL) {
+        fclose(inputLog);
+    }
+    free(replayRecords);
+    for (int i = 0; i < coreCount; i++) {
+        freeRunQueue(&cores[i].readyQueue);
+        pthread_mutex_destroy(&cores[i].readyLock);
+        free(cores[i].output);
+    }
+    freeQueue(&wakeQueue);
+    for (int i = 0; i < DEVICE_COUNT; i++) {
+        freeQueue(&devices[i].pending);
+    }
+    free(cores);
+    for (int i = 0; i < semaphoreCount; i++) {
+        for (int level = 0; level < MLFQ_LEVELS; level++) {
+            freeQueue(&semaphores[i].waiters[level]);
+        }
+        freeQueue(&semaphores[i].holders);
+        pthread_mutex_destroy(&semaphores[i].lock);
+    }
+    free(semaphores);
+    for (int i = 0; i < programCount; i++) {
+        free(programs[i]->file);
+        free(programs[i]->code);
+        free(programs[i]->semaphores);
+        free(programs[i]);
+    }
+    free(programs);
+    // Processes blocked forever, waiting for memory or yet to arrive when the run stopped never finished
+    for (Process *p = storageUnit.head, *next; p != NULL; p = next) {
+        next = p->storage_next;
+        freeProcess(p);
+    }
+    for (int i = memoryQueue.front, count = 0; count < memoryQueue.size; i = (i + 1) % memoryQueue.capacity, count++) {
+        freeProcess(memoryQueue.processes[i]);
+    }
+    for (int i = 0; i < eventQueue.size; i++) {
+        if (eventQueue.events[i].type == EVENT_ARRIVAL) {
+            freeProcess(eventQueue.events[i].process);
+        }
+    }
+    freeStorageUnit(&storageUnit);
+    freeQueue(&memoryQueue);
+    freeEventQueue(&eventQueue);
+    // A run that stopped on a deadlock or left processes that can never finish did not complete
+    return deadlockStopped || unfinished > 0 ? 2 : 0;
+}
+
+// Structure to represent a scenario of a batch manifest
+typedef struct {
+    char *name;
+    int argc;
+    char **argv; // Arguments of the run, argv[0] is the scenario name
+    pid_t pid;
+    int status;
+    struct timespec start;
+    double seconds;
+} Scenario;
+
+// Function to read a batch manifest, one scenario per line: <name> <arguments as on the command line>
+Scenario* readManifest(const char *path, int *count) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        perror("Error opening manifest");
+        return NULL;
+    }
+    Scenario *scenarios = NULL;
+    *count = 0;
+    char *line = NULL;
+    size_t capacity = 0;
+    while (getline(&line, &capacity, file) != -1) {
+        if (line[strspn(line, " \t\r\n")] == '\0' || line[strspn(line, " \t")] == '#') {
+            continue; // Skip blank lines and comments
+        }
+        scenarios = (Scenario *)realloc(scenarios, (*count + 1) * sizeof(Scenario));
+        if (scenarios == NULL) {
+            perror("Error growing manifest");
+            exit(EXIT_FAILURE);
+        }
+        Scenario *scenario = &scenarios[(*count)++];
+        memset(scenario, 0, sizeof(Scenario));
+        for (char *token = strtok(line, " \t\r\n"); token != NULL; token = strtok(NULL, " \t\r\n")) {
+            scenario->argv = (char **)realloc(scenario->argv, (scenario->argc + 2) * sizeof(char *));
+            if (scenario->argv == NULL) {
+                perror("Error growing scenario");
+                exit(EXIT_FAILURE);
+            }
+            scenario->argv[scenario->argc++] = strdup(token);
+        }
+        scenario->argv[scenario->argc] = NULL;
+        scenario->name = scenario->argv[0];
+    }
+    free(line);
+    fclose(file);
+    return scenarios;
+}
+
+// Function to decode the programs of a scenario ahead of the run, returns false if one cannot be loaded
+bool preloadPrograms(Scenario *scenario) {
+    for (int i = 1; i < scenario->argc; i += 2) {
+        RunOption *option = findRunOption(scenario->argv[i]);
+        if (option != NULL && !option->takes_value) {
+            i--; // Takes no value
+            continue;
+        }
+        // Unknown options are reported by the run itself
+        if (strncmp(scenario->argv[i], "--", 2) == 0 || i + 1 >= scenario->argc) {
+            continue;
+        }
+        if (loadProgram(scenario->argv[i + 1]) == NULL) {
+            printf("Failed to load program %s of scenario %s\n", scenario->argv[i + 1], scenario->name);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Function to start a scenario in a child process, which writes its output to <directory>/<name>.out
+void startScenario(Scenario *scenario, const char *directory, bool shareInput) {
+    fflush(stdout); // The child must not inherit unwritten output
+    clock_gettime(CLOCK_MONOTONIC, &scenario->start);
+    scenario->pid = fork();
+    if (scenario->pid < 0) {
+        perror("Error starting scenario");
+        exit(EXIT_FAILURE);
+    }
+    if (scenario->pid > 0) {
+        return;
+    }
+
+    // The child inherits the decoded programs from the batch, copy-on-write
+    char path[MAX_LINE_LENGTH * 3];
+    snprintf(path, sizeof(path), "%s/%s.out", directory, scenario->name);
+    if (freopen(path, "w", stdout) == NULL) {
+        perror("Error opening scenario output");
+        _exit(1);
+    }
+    if (!shareInput && freopen("/dev/null", "r", stdin) == NULL) {
+        perror("Error detaching scenario input");
+        _exit(1);
+    }
+    int status = runScenario(scenario->argc, scenario->argv);
+    fflush(stdout);
+    _exit(status);
+}
+
+// Function to run every scenario of a manifest, at most jobs at a time
+int runBatch(const char *manifest, int jobs, const char *directory) {
+    int count;
+    Scenario *scenarios = readManifest(manifest, &count);
+    if (scenarios == NULL) {
+        return 1;
+    }
+
+    // Decode every program once, before the runs fork off, each run binds the semaphores of its own programs
+    for (int i = 0; i < count; i++) {
+        if (!preloadPrograms(&scenarios[i])) {
+            return 1;
+        }
+    }
+    if (mkdir(directory, 0755) != 0 && access(directory, W_OK) != 0) {
+        perror("Error creating batch output directory");
+        return 1;
+    }
+
+    int started = 0;
+    int running = 0;
+    while (started < count || running > 0) {
+        if (started < count && running < jobs) {
+            startScenario(&scenarios[started++], directory, jobs == 1);
+            running++;
+            continue;
+        }
+        int status;
+        pid_t pid = wait(&status);
+        if (pid < 0) {
+            perror("Error waiting for scenario");
+            return 1;
+        }
+        for (int i = 0; i < started; i++) {
+            if (scenarios[i].pid == pid) {
+                struct timespec end;
+                clock_gettime(CLOCK_MONOTONIC, &end);
+                scenarios[i].seconds = (end.tv_sec - scenarios[i].start.tv_sec) + (end.tv_nsec - scenarios[i].start.tv_nsec) / 1e9;
+                scenarios[i].status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+                running--;
+            }
+        }
+    }
+
+    int failed = 0;
+    printf("Batch results:\n");
+    printf("+----------------------+--------+------------+\n");
+    printf("| Scenario             | Status | Host (s)   |\n");
+    printf("+----------------------+--------+------------+\n");
+    for (int i = 0; i < count; i++) {
+        printf("| %-20s | %-6s | %10.4f |\n", scenarios[i].name, scenarios[i].status == 0 ? "ok" : "failed", scenarios[i].seconds);
+        failed += scenarios[i].status != 0;
+        for (int j = 0; j < scenarios[i].argc; j++) {
+            free(scenarios[i].argv[j]);
         }
+        free(scenarios[i].argv);
+    }
+    printf("+----------------------+--------+------------+\n");
+    printf("Output of each scenario is in %s/<scenario>.out\n", directory);
+    free(scenarios);
+    return failed > 0 ? 1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3 || strcmp(argv[1], "--batch") != 0) {
+        return runScenario(argc, argv);
     }
 
-    printf("All processes have finished execution.\n");
-    return 0;
+    int jobs = 1;
+    const char *directory = "batch_output";
+    for (int i = 3; i < argc; i += 2) {
+        if (i + 1 >= argc) {
+            printf("Error: Missing value for %s\n", argv[i]);
+            return 1;
+        }
+        if (strcmp(argv[i], "--jobs") == 0) {
+            jobs = atoi(argv[i + 1]);
+            if (jobs < 1) {
+                printf("Error: At least one job is needed\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--batch-output") == 0) {
+            directory = argv[i + 1];
+        } else {
+            printf("Error: Unknown batch option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    return runBatch(argv[2], jobs, directory);
 }
 
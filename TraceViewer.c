@@ -0,0 +1,434 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+// Renders the event log written by OperatingSystem with --output events as the tables of --output tables
+
+#define MAX_NAME_LENGTH 100
+
+// Structure to represent the program of a process, taken from its program event
+typedef struct {
+    char **instructions;
+    int instruction_count;
+} Program;
+
+// Structure to represent the statistics of a core, taken from its core event
+typedef struct {
+    int busyCycles;
+    int migrations;
+} CoreStats;
+
+Program *programs; // Indexed by process ID
+int programCapacity = 0;
+char (*semaphoreNames)[MAX_NAME_LENGTH]; // Indexed by semaphore ID
+int semaphoreCount = 0;
+CoreStats *coreStats;
+int coreCount = 1;
+int levelCount = 1;
+int endCycle = 0;
+char fileStats[MAX_NAME_LENGTH] = ""; // Printed after the swap statistics, like the simulator does
+char ioStats[2 * MAX_NAME_LENGTH] = "";
+char deadlockStats[MAX_NAME_LENGTH] = "";
+const char *device_names[] = {"disk", "console"}; // Blocked entries with ID -1 - i wait for device i
+
+// Function to find the value of a key in an event, returns NULL if the event has no such key
+const char *findKey(const char *event, const char *key) {
+    char pattern[MAX_NAME_LENGTH + 4];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char *value = strstr(event, pattern);
+    return value == NULL ? NULL : value + strlen(pattern);
+}
+
+// Function to get an integer value of an event
+int intValue(const char *event, const char *key) {
+    const char *value = findKey(event, key);
+    return value == NULL ? 0 : atoi(value);
+}
+
+// Function to read a JSON string at *position into a newly allocated string, advancing past it
+char *readString(const char **position) {
+    const char *p = *position;
+    if (*p != '"') {
+        return strdup("");
+    }
+    p++;
+    char *text = (char *)malloc(strlen(p) + 1);
+    if (text == NULL) {
+        perror("Error reading trace string");
+        exit(EXIT_FAILURE);
+    }
+    char *out = text;
+    while (*p != '\0' && *p != '"') {
+        if (*p != '\\') {
+            *out++ = *p++;
+            continue;
+        }
+        p++;
+        if (*p == 'n') {
+            *out++ = '\n';
+            p++;
+        } else if (*p == 'u') {
+            *out++ = (char)strtol((char[]){p[1], p[2], p[3], p[4], '\0'}, NULL, 16);
+            p += 5;
+        } else if (*p != '\0') {
+            *out++ = *p++;
+        }
+    }
+    *out = '\0';
+    *position = *p == '"' ? p + 1 : p;
+    return text;
+}
+
+// Function to get a string value of an event, the result must be freed by the caller
+char *stringValue(const char *event, const char *key) {
+    const char *value = findKey(event, key);
+    if (value == NULL) {
+        return strdup("");
+    }
+    return readString(&value);
+}
+
+// Function to read the next tuple of an array of integer tuples, returns the number of integers read
+int readTuple(const char **position, int *values, int max_values) {
+    const char *p = strchr(*position, '[');
+    const char *end = strchr(*position, ']');
+    if (p == NULL || end == NULL || end < p) {
+        return 0;
+    }
+    int count = 0;
+    p++;
+    while (p < end && count < max_values) {
+        char *next;
+        values[count++] = (int)strtol(p, &next, 10);
+        if (next == p) {
+            break; // Not an integer
+        }
+        p = next;
+        while (p < end && (*p == ',' || *p == ' ')) {
+            p++;
+        }
+    }
+    *position = end + 1;
+    return count;
+}
+
+// Function to get the source text of an instruction of a process, a PC of -1 means it is swapped out
+const char *instructionText(int process_id, int pc) {
+    if (pc == -1) {
+        return "(swapped out)";
+    }
+    if (process_id < 0 || process_id >= programCapacity || pc >= programs[process_id].instruction_count) {
+        return "";
+    }
+    return programs[process_id].instructions[pc];
+}
+
+// Function to remember the program of a process
+void readProgram(const char *event) {
+    int process_id = intValue(event, "pid");
+    if (process_id >= programCapacity) {
+        int capacity = process_id + 1 > 2 * programCapacity ? process_id + 1 : 2 * programCapacity;
+        programs = (Program *)realloc(programs, capacity * sizeof(Program));
+        if (programs == NULL) {
+            perror("Error growing program table");
+            exit(EXIT_FAILURE);
+        }
+        memset(programs + programCapacity, 0, (capacity - programCapacity) * sizeof(Program));
+        programCapacity = capacity;
+    }
+    Program *program = &programs[process_id];
+    const char *p = findKey(event, "instructions");
+    if (p == NULL || *p != '[') {
+        return;
+    }
+    p++;
+    while (*p == '"') {
+        program->instructions = (char **)realloc(program->instructions, (program->instruction_count + 1) * sizeof(char *));
+        if (program->instructions == NULL) {
+            perror("Error growing program");
+            exit(EXIT_FAILURE);
+        }
+        program->instructions[program->instruction_count++] = readString(&p);
+        if (*p == ',') {
+            p++;
+        }
+    }
+}
+
+// Function to remember the name of a semaphore
+void readSemaphore(const char *event) {
+    int id = intValue(event, "id");
+    if (id >= semaphoreCount) {
+        semaphoreNames = realloc(semaphoreNames, (id + 1) * sizeof(*semaphoreNames));
+        if (semaphoreNames == NULL) {
+            perror("Error growing semaphore table");
+            exit(EXIT_FAILURE);
+        }
+        semaphoreCount = id + 1;
+    }
+    char *name = stringValue(event, "name");
+    snprintf(semaphoreNames[id], MAX_NAME_LENGTH, "%s", name);
+    free(name);
+}
+
+void printReadyQueue(const char *event, int core, int level) {
+    char name[48];
+    if (levelCount == 1 && coreCount == 1) {
+        snprintf(name, sizeof(name), "Ready");
+    } else if (levelCount == 1) {
+        snprintf(name, sizeof(name), "Ready (core %d)", core);
+    } else if (coreCount == 1) {
+        snprintf(name, sizeof(name), "Ready (level %d)", level);
+    } else {
+        snprintf(name, sizeof(name), "Ready (core %d, level %d)", core, level);
+    }
+    printf("%s Queue:\n", name);
+    printf("+------------+-----------------------+\n");
+    printf("| Process ID | Current Instruction   |\n");
+    printf("+------------+-----------------------+\n");
+    const char *p = findKey(event, "ready") + 1; // Inside the array of tuples
+    const char *end = findKey(event, "blocked");
+    int entry[4];
+    while (p < end && readTuple(&p, entry, 4) == 4 && p < end) {
+        if (entry[0] == core && entry[1] == level) {
+            printf("| %-10d | %-21s |\n", entry[2], instructionText(entry[2], entry[3]));
+        }
+    }
+    printf("+------------+-----------------------+\n");
+}
+
+// Function to render a state event as the ready queue, blocked queue and memory tables
+void printState(const char *event) {
+    for (int core = 0; core < coreCount; core++) {
+        for (int level = 0; level < levelCount; level++) {
+            printReadyQueue(event, core, level);
+        }
+    }
+
+    printf("Blocked Queue:\n");
+    printf("+------------+-----------------------+--------------+\n");
+    printf("| Process ID | Current Instruction   | Semaphore    |\n");
+    printf("+------------+-----------------------+--------------+\n");
+    const char *p = findKey(event, "blocked") + 1;
+    const char *end = findKey(event, "memory");
+    int entry[3];
+    while (p < end && readTuple(&p, entry, 3) == 3 && p < end) {
+        const char *semaphore = "";
+        if (entry[2] < 0 && -1 - entry[2] < (int)(sizeof(device_names) / sizeof(device_names[0]))) {
+            semaphore = device_names[-1 - entry[2]];
+        } else if (entry[2] >= 0 && entry[2] < semaphoreCount) {
+            semaphore = semaphoreNames[entry[2]];
+        }
+        printf("| %-10d | %-21s | %-12s |\n", entry[0], instructionText(entry[0], entry[1]), semaphore);
+    }
+    printf("+------------+-----------------------+--------------+\n");
+
+    printf("Memory Map:\n");
+    printf("+------------+-------------+-------------+\n");
+    printf("| Process ID | Lower Bound | Upper Bound |\n");
+    printf("+------------+-------------+-------------+\n");
+    p = findKey(event, "memory") + 1;
+    while (readTuple(&p, entry, 3) == 3) {
+        printf("| %-10d | %-11d | %-11d |\n", entry[0], entry[1], entry[2]);
+    }
+    printf("+------------+-------------+-------------+\n");
+}
+
+// Function to get the name of a semaphore by its ID
+const char *semaphoreName(int id) {
+    return id >= 0 && id < semaphoreCount ? semaphoreNames[id] : "?";
+}
+
+// Function to render a deadlock event, one line per process and holder it waits for
+void printDeadlock(const char *event, int cycle) {
+    printf("Deadlock detected at clock cycle %d:\n", cycle);
+    const char *p = findKey(event, "waits") + 1; // Inside the array of tuples
+    int entry[3];
+    while (readTuple(&p, entry, 3) == 3) {
+        printf("  Process %d waits for semaphore %s held by Process %d\n", entry[0], semaphoreName(entry[1]), entry[2]);
+    }
+    char *action = stringValue(event, "action");
+    int victim = intValue(event, "victim");
+    if (strcmp(action, "abort") == 0) {
+        printf("Process %d is aborted to break the deadlock\n", victim);
+    } else if (strcmp(action, "preempt") == 0) {
+        printf("Process %d is restarted from its first instruction to break the deadlock\n", victim);
+    } else if (strcmp(action, "stop") == 0) {
+        printf("Stopping the simulation because of the deadlock\n");
+    }
+    free(action);
+}
+
+// Function to render a single event
+void printEvent(const char *event) {
+    char *type = stringValue(event, "type");
+    int cycle = intValue(event, "cycle");
+    int process_id = intValue(event, "pid");
+
+    if (strcmp(type, "run") == 0) {
+        coreCount = intValue(event, "cores");
+        levelCount = intValue(event, "levels");
+        coreStats = (CoreStats *)calloc(coreCount, sizeof(CoreStats));
+    } else if (strcmp(type, "semaphore") == 0) {
+        readSemaphore(event);
+    } else if (strcmp(type, "program") == 0) {
+        readProgram(event);
+    } else if (strcmp(type, "arrive") == 0) {
+        printf("Process %d has arrived at clock cycle %d\n", process_id, cycle);
+        printf("Ready Queue:\n");
+        printf("+------------+-----------------------+\n");
+        printf("| Process ID | Current Instruction   |\n");
+        printf("+------------+-----------------------+\n");
+        printf("| %-10d | %-21s |\n", process_id, instructionText(process_id, 0));
+        printf("+------------+-----------------------+\n");
+    } else if (strcmp(type, "wait_memory") == 0) {
+        printf("Process %d has arrived at clock cycle %d and is waiting for memory\n", process_id, cycle);
+    } else if (strcmp(type, "idle") == 0) {
+        printf("CPU idle from clock cycle %d to %d\n", cycle, intValue(event, "until"));
+    } else if (strcmp(type, "state") == 0) {
+        printState(event);
+    } else if (strcmp(type, "exec") == 0) {
+        const char *text = instructionText(process_id, intValue(event, "pc"));
+        if (coreCount == 1) {
+            printf("Executing instruction [%s] from Process %d at clock cycle %d\n", text, process_id, cycle);
+        } else {
+            printf("Executing instruction [%s] from Process %d at clock cycle %d on core %d\n", text, process_id, cycle, intValue(event, "core"));
+        }
+    } else if (strcmp(type, "output") == 0) {
+        char *text = stringValue(event, "text");
+        fputs(text, stdout);
+        free(text);
+    } else if (strcmp(type, "io_start") == 0) {
+        char *device = stringValue(event, "device");
+        printf("Process %d is waiting for the %s until clock cycle %d\n", process_id, device, intValue(event, "until"));
+        free(device);
+    } else if (strcmp(type, "input_wait") == 0) {
+        printf("Process %d is waiting for input on the console\n", process_id);
+    } else if (strcmp(type, "io_stats") == 0) {
+        int requests = intValue(event, "requests");
+        if (requests > 0) {
+            char *device = stringValue(event, "device");
+            size_t length = strlen(ioStats);
+            snprintf(ioStats + length, sizeof(ioStats) - length, "I/O statistics: %s serviced %d requests, busy for %d cycles\n",
+                     device, requests, intValue(event, "busy"));
+            free(device);
+        }
+    } else if (strcmp(type, "checkpoint") == 0 || strcmp(type, "restore") == 0) {
+        char *path = stringValue(event, "path");
+        if (strcmp(type, "checkpoint") == 0) {
+            printf("Checkpoint written to %s at clock cycle %d\n", path, cycle);
+        } else {
+            printf("Restored checkpoint %s at clock cycle %d\n", path, cycle);
+        }
+        free(path);
+    } else if (strcmp(type, "deadlock") == 0) {
+        printDeadlock(event, cycle);
+    } else if (strcmp(type, "priority_inversion") == 0) {
+        printf("Priority inversion: Process %d at level %d waits for semaphore %s held by Process %d at level %d\n", process_id,
+               intValue(event, "level"), semaphoreName(intValue(event, "semaphore")), intValue(event, "holder"), intValue(event, "holder_level"));
+    } else if (strcmp(type, "inherit") == 0) {
+        int from = intValue(event, "from");
+        if (from > 0) {
+            printf("Process %d inherits priority level %d from Process %d\n", process_id, intValue(event, "level"), from);
+        } else {
+            printf("Process %d returns to priority level %d\n", process_id, intValue(event, "level"));
+        }
+    } else if (strcmp(type, "deadlock_stats") == 0) {
+        int deadlocks = intValue(event, "deadlocks");
+        int inversions = intValue(event, "inversions");
+        if (deadlocks + inversions > 0) {
+            snprintf(deadlockStats, sizeof(deadlockStats), "Deadlocks: %d detected, %d priority inversions\n", deadlocks, inversions);
+        }
+    } else if (strcmp(type, "swap_out") == 0) {
+        printf("Process %d swapped out to disk at clock cycle %d (%d bytes)\n", process_id, cycle, intValue(event, "bytes"));
+    } else if (strcmp(type, "swap_in") == 0) {
+        printf("Process %d swapped in from disk at clock cycle %d (%d bytes)\n", process_id, cycle, intValue(event, "bytes"));
+    } else if (strcmp(type, "finish") == 0) {
+        printf("Process %d has finished execution.\n", process_id);
+    } else if (strcmp(type, "end") == 0) {
+        endCycle = cycle;
+        int blocked = intValue(event, "blocked");
+        int aborted = intValue(event, "aborted");
+        if (blocked > 0) {
+            printf("%d processes are blocked forever at clock cycle %d.\n", blocked, cycle);
+        } else if (aborted == 0) {
+            printf("All processes have finished execution.\n");
+        }
+        if (aborted > 0) {
+            printf("%d processes finished, %d aborted by deadlock resolution.\n", intValue(event, "finished"), aborted);
+        }
+    } else if (strcmp(type, "unfinished") == 0) {
+        char *state = stringValue(event, "state");
+        printf("Process %d did not finish: %s\n", process_id, state);
+        free(state);
+    } else if (strcmp(type, "core") == 0) {
+        int core = intValue(event, "core");
+        if (core >= 0 && core < coreCount) {
+            coreStats[core].busyCycles = intValue(event, "busy");
+            coreStats[core].migrations = intValue(event, "migrations");
+        }
+    } else if (strcmp(type, "file_stats") == 0) {
+        int hits = intValue(event, "hits");
+        int misses = intValue(event, "misses");
+        int writes = intValue(event, "writes");
+        if (hits + misses + writes > 0) {
+            snprintf(fileStats, sizeof(fileStats), "File cache: %d hits, %d misses, %d writes, %d flushes\n",
+                     hits, misses, writes, intValue(event, "flushes"));
+        }
+    } else if (strcmp(type, "swap_stats") == 0) {
+        if (coreCount > 1) {
+            printf("Core statistics:\n");
+            printf("+------+-------------+------------+\n");
+            printf("| Core | Utilization | Migrations |\n");
+            printf("+------+-------------+------------+\n");
+            for (int i = 0; i < coreCount; i++) {
+                double utilization = endCycle > 0 ? 100.0 * coreStats[i].busyCycles / endCycle : 0;
+                printf("| %-4d | %10.1f%% | %-10d |\n", i, utilization, coreStats[i].migrations);
+            }
+            printf("+------+-------------+------------+\n");
+        }
+        printf("Swap statistics: %d swap-ins (%d bytes), %d swap-outs (%d bytes)\n", intValue(event, "swap_ins"),
+               intValue(event, "bytes_in"), intValue(event, "swap_outs"), intValue(event, "bytes_out"));
+        fputs(ioStats, stdout);
+        fputs(fileStats, stdout);
+        fputs(deadlockStats, stdout);
+    }
+    free(type);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 2) {
+        printf("Usage: %s [<trace_file>]\n", argv[0]);
+        return 1;
+    }
+    FILE *trace = stdin;
+    if (argc == 2) {
+        trace = fopen(argv[1], "r");
+        if (trace == NULL) {
+            perror("Error opening trace file");
+            return 1;
+        }
+    }
+
+    char *line = NULL;
+    size_t capacity = 0;
+    while (getline(&line, &capacity, trace) != -1) {
+        printEvent(line);
+    }
+    free(line);
+    if (trace != stdin) {
+        fclose(trace);
+    }
+
+    for (int i = 0; i < programCapacity; i++) {
+        for (int j = 0; j < programs[i].instruction_count; j++) {
+            free(programs[i].instructions[j]);
+        }
+        free(programs[i].instructions);
+    }
+    free(programs);
+    free(semaphoreNames);
+    free(coreStats);
+    return 0;
+}